@@ -0,0 +1,244 @@
+#include "ClothSystem.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// times every ClothSystem phase in isolation across grid sizes and simulation modes
+// and writes the results as JSON (ns per call, per particle and per spring)
+// usage: cloth_bench [--sizes 25,128,512,1024] [--modes tear,collision,flag]
+//                    [--min-time seconds] [--warmup frames] [--out file.json]
+
+struct ClothBench {
+    static void createClothGrid(ClothSystem& cloth)     { cloth.createClothGrid(); }
+    static void applyForces(ClothSystem& cloth)         { cloth.applyForces(); }
+    static void integrateVerlet(ClothSystem& cloth)     { cloth.integrateVerlet(cloth.fixedTimeStep); }
+    static void satisfyConstraints(ClothSystem& cloth)  { cloth.satisfyConstraints(); }
+    static void solveConstraints(ClothSystem& cloth)    { cloth.solveConstraints(); }
+    static void handleCollisions(ClothSystem& cloth)    { cloth.handleCollisions(); }
+    static void computeNormals(ClothSystem& cloth)      { cloth.computeNormals(cloth.windStrength > 0.0f); }
+    
+    // a settled cloth has nothing left to rebuild, time the work a tear or reset leaves behind
+    static void updateVertexData(ClothSystem& cloth) {
+        cloth.meshDirty = true;
+        cloth.normalsDirty = true;
+        cloth.updateVertexData();
+    }
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::vector<int> sizes = { 25, 128, 512, 1024 };
+    std::vector<SimulationMode> modes = { SimulationMode::TEAR, SimulationMode::COLLISION, SimulationMode::FLAG };
+    double minTime = 0.25;
+    int warmupFrames = 30;
+    std::string outPath;
+};
+
+struct Phase {
+    const char* name;
+    std::function<void(ClothSystem&)> run;
+};
+
+struct Result {
+    std::string phase;
+    std::string mode;
+    int grid;
+    size_t particles;
+    size_t springs;
+    int calls;
+    double nsPerCall;       // median over samples
+    double nsMin;
+};
+
+const char* modeName(SimulationMode mode) {
+    switch (mode) {
+        case SimulationMode::TEAR:      return "tear";
+        case SimulationMode::COLLISION: return "collision";
+        case SimulationMode::FLAG:      return "flag";
+    }
+    return "unknown";
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+
+        if (arg == "--sizes") {
+            options.sizes.clear();
+            for (const auto& item : splitList(value)) options.sizes.push_back(std::atoi(item.c_str()));
+        } else if (arg == "--modes") {
+            options.modes.clear();
+            for (const auto& item : splitList(value)) {
+                if (item == "tear")             options.modes.push_back(SimulationMode::TEAR);
+                else if (item == "collision")   options.modes.push_back(SimulationMode::COLLISION);
+                else if (item == "flag")        options.modes.push_back(SimulationMode::FLAG);
+                else {
+                    std::cerr << "Unknown mode: " << item << '\n';
+                    return false;
+                }
+            }
+        } else if (arg == "--min-time") {
+            options.minTime = std::atof(value.c_str());
+        } else if (arg == "--warmup") {
+            options.warmupFrames = std::atoi(value.c_str());
+        } else if (arg == "--out") {
+            options.outPath = value;
+        } else {
+            std::cerr << "Unknown option: " << arg << '\n';
+            return false;
+        }
+    }
+    if (argc % 2 == 0) {
+        std::cerr << "Missing value for " << argv[argc - 1] << '\n';
+        return false;
+    }
+
+    for (int size : options.sizes) {
+        if (size < 3) {
+            std::cerr << "Grid sizes must be at least 3\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// repeats a phase until minTime has passed (at least 3 samples) and keeps the median
+Result measure(const Phase& phase, ClothSystem& cloth, const Options& options) {
+    std::vector<double> samples;
+    double spent = 0.0;
+
+    phase.run(cloth);   // warm caches and lazily built state
+
+    while (spent < options.minTime || samples.size() < 3) {
+        Clock::time_point start = Clock::now();
+        phase.run(cloth);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        samples.push_back(ns);
+        spent += ns * 1e-9;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.phase = phase.name;
+    result.calls = static_cast<int>(samples.size());
+    result.nsPerCall = samples[samples.size() / 2];
+    result.nsMin = samples.front();
+    return result;
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results) {
+    out << "{\n";
+    out << "  \"simd\": \"" << ParticleKernels::levelName(ParticleKernels::get().level) << "\",\n";
+    out << "  \"threads\": " << ThreadPool::shared().size() << ",\n";
+    out << "  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    {\"phase\": \"" << r.phase << "\""
+            << ", \"mode\": \"" << r.mode << "\""
+            << ", \"grid\": " << r.grid
+            << ", \"particles\": " << r.particles
+            << ", \"springs\": " << r.springs
+            << ", \"calls\": " << r.calls
+            << ", \"ns_per_call\": " << r.nsPerCall
+            << ", \"ns_min\": " << r.nsMin
+            << ", \"ns_per_particle\": " << r.nsPerCall / r.particles
+            << ", \"ns_per_spring\": " << r.nsPerCall / r.springs
+            << "}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--sizes 25,128,512,1024] [--modes tear,collision,flag]"
+                  << " [--min-time seconds] [--warmup frames] [--out file.json]\n";
+        return 1;
+    }
+
+    // writeVertices fills plain memory where the renderer hands in mapped buffers,
+    // sized for each cloth before timing starts
+    std::vector<float> vertexPositions, vertexNormals;
+    auto writeVertices = [&](ClothSystem& cloth) { cloth.writeVertices(vertexPositions.data(), vertexNormals.data()); };
+
+    const std::vector<Phase> phases = {
+        { "createClothGrid",    ClothBench::createClothGrid },
+        { "applyForces",        ClothBench::applyForces },
+        { "integrateVerlet",    ClothBench::integrateVerlet },
+        { "satisfyConstraints", ClothBench::satisfyConstraints },
+        { "solveConstraints",   ClothBench::solveConstraints },
+        { "handleCollisions",   ClothBench::handleCollisions },
+        { "updateVertexData",   ClothBench::updateVertexData },
+        { "computeNormals",     ClothBench::computeNormals },
+        { "writeVertices",      writeVertices },
+    };
+
+    std::vector<Result> results;
+
+    for (int size : options.sizes) {
+        for (SimulationMode mode : options.modes) {
+            std::cerr << "grid " << size << "x" << size << ", " << modeName(mode) << '\n';
+
+            for (const Phase& phase : phases) {
+                // fresh, settled cloth per phase so one phase's drift does not skew the next
+                ClothSystem cloth(size, size, 4.0f, 4.0f);
+                cloth.setMode(mode);
+                for (int frame = 0; frame < options.warmupFrames; ++frame) {
+                    cloth.update(1.0f / 60.0f);
+                }
+                vertexPositions.assign(cloth.getVertexCount() * 3, 0.0f);
+                vertexNormals.assign(cloth.getVertexCount() * 3, 0.0f);
+
+                Result result = measure(phase, cloth, options);
+                result.mode = modeName(mode);
+                result.grid = size;
+                result.particles = cloth.getParticleCount();
+                result.springs = cloth.getSpringCount();
+                results.push_back(result);
+            }
+        }
+    }
+
+    if (options.outPath.empty()) {
+        writeJson(std::cout, results);
+    } else {
+        std::ofstream file(options.outPath);
+        if (!file) {
+            std::cerr << "Failed to open " << options.outPath << '\n';
+            return 1;
+        }
+        writeJson(file, results);
+    }
+
+    return 0;
+}
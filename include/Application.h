@@ -7,18 +7,22 @@
 #include <glm/glm.hpp>
 #include <memory>
 
-class ClothSystem;
+class SimulationThread;
 class Renderer;
 class Camera;
+struct ClothSnapshot;
 enum class SimulationMode;
 
 class Application {
 private:
     GLFWwindow* window;
-    std::unique_ptr<ClothSystem> clothSystem;
+    std::unique_ptr<SimulationThread> simulation;
     std::unique_ptr<Renderer> renderer;
     std::unique_ptr<Camera> camera;
     
+    // last completed simulation step, taken once per frame
+    const ClothSnapshot* snapshot = nullptr;
+    
     // application state
     SimulationMode currentMode;
     bool wireframe = false;
@@ -53,7 +57,6 @@ public:
     GLFWwindow* GetWindow() const { return window; }
     
 private:
-    void update(float deltaTime);
     void render();
     void renderUI();
     void updatePerformanceStats(float deltaTime);
@@ -69,6 +72,11 @@ private:
     void renderPerformanceInfo();
     void renderInstructions();
     
+    // simulation commands
+    void setMode(SimulationMode mode);
+    void resetSimulation();
+    void togglePause();
+    
     // static callbacks
     static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
     static void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
@@ -0,0 +1,94 @@
+#ifndef CLOTH_ISLANDS_H
+#define CLOTH_ISLANDS_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+class ParticleStore;
+class SpringIncidence;
+struct Spring;
+
+// connected pieces of a cloth - particles joined by a path of active springs
+// kept up to date as springs break: the ends of every broken link are checked against one particle
+// of their piece by searching from both at once, which stops as soon as the searches meet, so a
+// tear that leaves a piece whole costs a handful of visits and a split about the size of the smaller part
+class ClothIslands {
+public:
+    struct Island {
+        std::vector<int> particles;
+
+        // solve and sleep state, owned by ClothSystem
+        std::vector<int> springs;       // solved as one unit, standalone islands only
+        bool standalone = false;
+        bool sleeping = false;
+        bool grounded = false;          // touched the ground plane in the last step
+        int quietSteps = 0;
+        glm::vec3 boundsMin = glm::vec3(0.0f);      // while asleep
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+    };
+
+private:
+    static constexpr int SEARCH_BUDGET = 1024;      // visits before a link check gives up and relabels the island
+
+    std::vector<Island> islands;
+    std::vector<int> freeIds;
+    std::vector<int> labels;            // island per particle, -1 once removed
+    std::vector<int> slots;             // position inside its island's particle list
+
+    std::vector<int> touched;           // ends of broken links, their island may have come apart
+    std::vector<int> anchors;           // per island, the touched particle the others are checked against
+    std::vector<int> changed;
+    std::vector<unsigned char> changedMarks;
+    bool changesTaken = false;          // changed is cleared when the next round of edits starts
+    std::vector<int> relabelQueue;
+    std::vector<unsigned char> relabelMarks;
+
+    // search scratch - a particle was reached by a search when its stamp matches
+    std::vector<unsigned int> stamps;
+    unsigned int stamp = 0;
+    std::vector<int> frontA, frontB;
+
+public:
+    void build(const ParticleStore& particles, const SpringIncidence& incidence, const std::vector<Spring>& springs);
+
+    // the link between the two is gone, resolved by the next update
+    void linkBroken(int particle1, int particle2) {
+        touched.push_back(particle1);
+        touched.push_back(particle2);
+    }
+
+    // takes a particle out of its island, the links to its neighbors are reported as they break
+    void removeParticle(int particle);
+
+    // resolves the broken links, returns the islands whose particles changed, new ones included
+    const std::vector<int>& update(const SpringIncidence& incidence, const std::vector<Spring>& springs);
+
+    // a full relabel from scratch - true if it splits the particles exactly as the incremental labels do,
+    // with no links left unresolved; for validation runs, it costs as much as build
+    bool matchesFloodFill(const ParticleStore& particles, const SpringIncidence& incidence,
+                          const std::vector<Spring>& springs) const;
+
+    int islandOf(int particle) const { return labels[particle]; }
+    Island& operator[](int island) { return islands[island]; }
+    const Island& operator[](int island) const { return islands[island]; }
+
+    // ids up to capacity, empty islands are free
+    int capacity() const { return static_cast<int>(islands.size()); }
+    int count() const { return static_cast<int>(islands.size() - freeIds.size()); }
+
+private:
+    int allocate();
+    void takeChanges();
+    void markChanged(int island);
+    unsigned int nextStamp();
+    void moveParticles(const std::vector<int>& part, int island);
+    void checkLink(int particle1, int particle2, const SpringIncidence& incidence, const std::vector<Spring>& springs);
+    void relabel(int island, const SpringIncidence& incidence, const std::vector<Spring>& springs);
+
+    template <typename Visitor>
+    static void forEachNeighbor(int particle, const SpringIncidence& incidence, const std::vector<Spring>& springs,
+                                Visitor&& visit);
+};
+
+#endif
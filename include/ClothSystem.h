@@ -1,9 +1,22 @@
 #ifndef CLOTH_SYSTEM_H
 #define CLOTH_SYSTEM_H
 
+#include "ParticleStore.h"
+#include "ClothIslands.h"
+#include "ConstraintColoring.h"
+#include "SpringIncidence.h"
+#include "SpatialHash.h"
+#include "StepScheduler.h"
+#include "WindField.h"
+
 #include <glm/glm.hpp>
+#include <algorithm>
 #include <vector>
 #include <memory>
+#include <mutex>
+
+struct ParticleKernels;
+class ThreadPool;
 
 enum class SimulationMode {
     TEAR,
@@ -11,17 +24,16 @@ enum class SimulationMode {
     FLAG
 };
 
-struct Particle {
-    glm::vec3 position;
-    glm::vec3 oldPosition;
-    glm::vec3 velocity;
-    glm::vec3 force;
-    
-    float mass = 1.0f;
-    bool pinned = false;
-    bool active = true;
-    
-    Particle(const glm::vec3& pos);
+enum class SolverMode {
+    PBD,        // stiffness-scaled position corrections
+    XPBD        // compliance-based corrections, independent of iteration count and timestep
+};
+
+// order of the particles in memory
+enum class ParticleLayout {
+    ROWS,       // row-major
+    TILES       // tile by tile, row-major inside each solver tile - a tile and the row below it share
+                // a few pages rather than touching one page per row, which pays off on large grids
 };
 
 struct Spring {
@@ -34,12 +46,43 @@ struct Spring {
     int particle1, particle2;
     float restLength;
     float stiffness;
+    float compliance = 0.0f;    // XPBD, inverse stiffness
     SpringType type;
     bool active = true;
     
     Spring(int p1, int p2, float length, float k, SpringType t);
 };
 
+// wall-clock time spent in each phase of update(), accumulated until reset
+struct PhaseTimings {
+    double forces = 0.0;
+    double integrate = 0.0;
+    double constraints = 0.0;
+    double collisions = 0.0;
+    double normals = 0.0;       // end of each step, with the face normals the wind reuses
+    double bookkeeping = 0.0;   // render state, islands, sleep and scene animation around the solver
+    double vertexData = 0.0;
+    int steps = 0;          // fixed steps taken
+    int skippedSteps = 0;   // fixed steps the scheduler gave up on
+    int frames = 0;         // update() calls
+    
+    double total() const { return forces + integrate + constraints + collisions + normals + bookkeeping + vertexData; }
+    
+    PhaseTimings& operator+=(const PhaseTimings& other) {
+        forces += other.forces;
+        integrate += other.integrate;
+        constraints += other.constraints;
+        collisions += other.collisions;
+        normals += other.normals;
+        bookkeeping += other.bookkeeping;
+        vertexData += other.vertexData;
+        steps += other.steps;
+        skippedSteps += other.skippedSteps;
+        frames += other.frames;
+        return *this;
+    }
+};
+
 struct CollisionSphere {
     glm::vec3 center;
     float radius;
@@ -48,39 +91,174 @@ struct CollisionSphere {
 };
 
 class ClothSystem {
+    // microbenchmarks drive the individual phases directly
+    friend struct ClothBench;
+    
 private:
-    std::vector<Particle> particles;
+    ParticleStore particles;
     std::vector<Spring> springs;
+    SpringIncidence incidence;          // particle -> active springs
     std::vector<CollisionSphere> spheres;
+    const std::vector<CollisionSphere>* sharedColliders = nullptr;     // owned by a ClothWorld, read-only here
     
     // physics sim params
     float gravity = -9.81f;
     float damping = 0.99f;
     float windStrength = 0.0f;
     float tearThreshold = 2.0f;
-    float elapsedTime = 0.0f;
-    const float fixedTimeStep = 1.0f / 60.0f;
+    static constexpr float GROUND_HEIGHT = -5.0f;
+    float fixedTimeStep = 1.0f / 60.0f;
+    StepScheduler scheduler{ fixedTimeStep };
+    static constexpr float DAMPING_TIME_STEP = 1.0f / 60.0f;    // damping is given per step of this length
     glm::vec3 windDirection = glm::vec3(1.0f, 0.0f, 0.5f);
     
+    // constraint solver - each fixed step is split into substeps, each running solverIterations passes
+    SolverMode solverMode = SolverMode::PBD;
+    int substeps = 1;
+    int solverIterations = 3;
+    float substepDeltaTime = 1.0f / 60.0f;
+    float typeCompliance[3] = { 1e-6f, 1e-5f, 1e-4f };     // per Spring::SpringType
+    std::vector<float> lambdas;                             // XPBD multipliers per spring, reset every substep
+    
     // grid properties
     int gridWidth, gridHeight;
+    ParticleLayout layout = ParticleLayout::ROWS;
     float clothWidth, clothHeight;
+    glm::vec3 origin;                   // middle of the cloth's bottom edge
     
     // object movement for collision mode
     float objectMoveTime = 4.0f;
     float objectMoveSpeed = 0.8f;  
     float objectMoveRange = 8.0f;  
+    glm::vec3 objectStartPos = glm::vec3(0.0f);     // of the first sphere
+    float objectAngle = 0.0f;                       // tracks semicircle motion
+    bool objectGoingForward = true;
+    
+    // turbulence is a pure function of (seed, step, particle), see CounterRandom
+    uint32_t windSeed;
+    uint64_t windStep = 0;              // fixed steps since the last reset
+    
+    // gust fronts travelling through space, sampled per particle at the end of every step into
+    // windX/Y/Z, which the normals pass then turns into velocity relative to the air
+    WindField windField;
+    AlignedVector<float> windX, windY, windZ;
+    
+    // per-triangle lift and drag from the end of the last step, added by applyForces
+    // coefficients are per unit of cloth mass, so the response does not depend on the grid resolution
+    AlignedVector<float> aeroX, aeroY, aeroZ;
+    bool aeroReady = false;
+    float aeroDrag = 0.25f;
+    float aeroLift = 0.1f;
+    float faceMass = 0.5f;              // particle mass one triangle of the grid stands for
+    
+    // SIMD particle kernels chosen at startup
+    const ParticleKernels* kernels;
     
-    // wind variation for flag mode
-    float windVariationTime = 0.0f;
-    float windVariationStrength = 0.3f;
+    // parallel constraint solve
+    static constexpr size_t SOLVER_GRAIN_SIZE = 2048;
+    static constexpr size_t WIND_GRAIN_SIZE = 4096;      // particles, a multiple of the lane padding
+    ThreadPool* threadPool;
+    ConstraintColoring coloring;
+    std::vector<int> tornSprings;       // torn during a parallel pass, removed from the tiles/coloring afterwards
+    size_t deadSprings = 0;             // torn and still in springs, dropped by compactSprings
+    std::mutex tornMutex;
     
-    // vertex data
-    std::vector<float> vertices;
+    // matrix-free stencil solve - springs of untorn tiles are derived from (x, y),
+    // only tiles containing a tear fall back to the explicit spring list
+    static constexpr int TILE_SIZE = 16;                // a power of two, see particleIndex
+    static constexpr int STENCIL_KINDS = 6;
+    static constexpr size_t STENCIL_GRAIN_SIZE = 4;
+    int tilesX = 0, tilesY = 0;
+    std::vector<unsigned char> tileIntact;
+    std::vector<int> intactTiles;       // untorn and not asleep along with all their neighbors
+    bool intactTilesDirty = true;
+    std::vector<int> gridSprings;       // spring index per (particle, kind), -1 past the grid border or once compacted away
+    float stencilRestLength[STENCIL_KINDS];
+    
+    // cache blocking - on large grids the untorn tiles are solved a block of BLOCK_TILES^2 tiles at a
+    // time, every iteration in a row while the block and its halo sit in L2, instead of streaming the
+    // whole grid through memory once per pass; a block's springs reach at most 2 particles past its
+    // right and bottom edges and 1 past its left, so blocks of the same (x, y) parity never share a
+    // particle and each of the 4 parities is solved in parallel, the halos caught up by the next
+    static constexpr int BLOCK_TILES = 4;
+    static constexpr size_t BLOCKING_MIN_PARTICLES = 128 * 128;     // below this the grid stays in cache anyway
+    bool cacheBlocking = true;
+    std::vector<int> blockTiles;        // intact tiles by block, blocks by parity
+    std::vector<size_t> blockOffsets;   // first entry in blockTiles per block, and the end
+    size_t parityOffsets[5] = {};       // first block per parity, and the end
+    std::vector<unsigned char> tileTearing;     // a stencil spring of the tile tore during the solve
+    
+    // sleeping - a tile whose neighborhood moved less than sleepThreshold per second for SLEEP_WINDOW
+    // steps in a row is held in place and skipped by integration, constraints, collisions and normals
+    // until a tear, a moving collider or wind wakes it
+    static constexpr int SLEEP_WINDOW = 30;             // steps
+    static constexpr float WAKE_FACTOR = 20.0f;         // motion that wakes a sleeping neighbor, relative to sleepThreshold
+    static constexpr size_t SLEEP_GRAIN_SIZE = 8;       // tiles
+    bool sleepEnabled = true;
+    float sleepThreshold = 0.05f;                       // units per second
+    std::vector<unsigned short> tileQuietSteps;         // consecutive steps below the threshold
+    std::vector<unsigned char> tileSleeping;
+    std::vector<unsigned char> tileParked;              // asleep along with every neighbor, left out of the solve
+    std::vector<unsigned char> tileMarks;               // updateSleep scratch
+    std::vector<glm::vec3> tileBoundsMin, tileBoundsMax;        // of sleeping tiles
+    std::vector<unsigned char> bandDirty;               // tile rows whose normals the last step changed
+    std::vector<CollisionSphere> lastColliders;         // own and shared, as of the last step
+    int sleepingTiles = 0;
+    int restingSteps = 0;                               // consecutive steps with every tile asleep
+    uint64_t renderVersion = 0;                         // changes whenever writeVertices output can
+    
+    // islands - pieces torn off the cloth, see ClothIslands
+    // a piece lying wholly in torn tiles is standalone: its springs leave the coloring and the
+    // whole piece is solved as one task, all iterations in a row, next to the other pieces
+    // a standalone piece that came to rest on the ground goes to sleep on its own
+    static constexpr size_t STANDALONE_LIMIT = 4096;    // particles, larger pieces stay with the tiles
+    static constexpr float GROUND_CONTACT = 1e-3f;      // above the ground plane, still touching it
+    static constexpr size_t ISLAND_GRAIN_SIZE = 4;
+    ClothIslands islands;
+    std::vector<int> standaloneIslands;
+    std::vector<int> pendingTornTiles;                  // torn since the last updateIslands
+    std::vector<unsigned char> islandMarks;             // updateIslands scratch
+    bool islandChecks = false;                          // compare the islands to a flood fill every step
+    int islandMismatches = 0;
+    
+    // tear brush - particle positions are indexed lazily, at most once per update()
+    float tearRadius = 0.08f;
+    SpatialHash spatialIndex;
+    bool spatialIndexDirty = true;
+    
+    // per-phase profiling
+    PhaseTimings timings;
+    
+    // vertex data - positions and normals are written straight into the caller's buffers by
+    // writeVertices, texture coords only change with the topology
+    std::vector<float> texCoords;           // 2 per render vertex
     std::vector<unsigned int> indices;
     
+    // render mesh topology - persists across frames, quads are patched out as particles are
+    // removed and the vertex remap is only rebuilt once enough of its vertices are dead
+    std::vector<int> vertexParticles;       // particle per render vertex
+    std::vector<int> particleVertex;        // render vertex per particle, -1 if none
+    std::vector<int> quadSlot;              // position of each grid quad in indices (in 6s), -1 if absent
+    std::vector<int> slotQuad;
+    size_t deadVertices = 0;
+    bool meshDirty = true;
+    
+    // render interpolation - state at the start of the last step, blended towards the current
+    // state by the fraction of a step simulated time has moved on since (getInterpolationAlpha)
+    // kept apart from the Verlet previous positions, which collisions rewrite
+    AlignedVector<float> renderPrevX, renderPrevY, renderPrevZ;
+    std::vector<glm::vec3> renderPrevSphereCenters;
+    
+    // unnormalized vertex normals per particle, accumulated from the faces each frame
+    AlignedVector<float> normalX, normalY, normalZ;
+    AlignedVector<float> faceNormals;           // one quad row of face normals and forces, scratch for computeNormals
+    AlignedVector<float> rowScratch;            // tiled layout - two particle rows gathered for computeNormals
+    std::vector<int> rowParticles;              // and the particle of each of their entries
+    bool normalsDirty = true;                   // positions or topology changed since the last computeNormals
+    uint64_t topologyVersion = 0;
+    
 public:
-    ClothSystem(int width, int height, float w, float h);
+    ClothSystem(int width, int height, float w, float h, const glm::vec3& origin = glm::vec3(0.0f));
     
     void update(float deltaTime);
     void setMode(SimulationMode mode);
@@ -88,46 +266,201 @@ public:
     void reset();
     
     // getters (rendering)
-    const std::vector<float>& getVertices() const { return vertices; }
+    size_t getVertexCount() const { return vertexParticles.size(); }
+    // 3 floats per vertex each, positions blended from the previous step by alpha
+    void writeVertices(float* positions, float* normals, float alpha = 1.0f) const;
+    void writePreviousPositions(float* positions) const;           // for blending later on another thread
+    float getInterpolationAlpha() const;                            // in [0, 1]
+    const std::vector<float>& getTexCoords() const { return texCoords; }
     const std::vector<unsigned int>& getIndices() const { return indices; }
+    uint64_t getTopologyVersion() const { return topologyVersion; }      // changes whenever indices or texCoords do
+    uint64_t getRenderVersion() const { return renderVersion; }          // with the same topology, same vertices
+    bool isAtRest() const { return restingSteps >= 2; }                 // previous and current state are equal
+    size_t getActiveParticleCount() const { return vertexParticles.size() - deadVertices; }
     const std::vector<CollisionSphere>& getSpheres() const { return spheres; }
+    const std::vector<glm::vec3>& getPreviousSphereCenters() const { return renderPrevSphereCenters; }
+    
+    // getters (profiling)
+    const PhaseTimings& getPhaseTimings() const { return timings; }
+    void resetPhaseTimings() { timings = PhaseTimings(); }
+    size_t getParticleCount() const { return particles.size(); }
+    size_t getSpringCount() const { return springs.size(); }
+    int getSleepingTileCount() const { return sleepingTiles; }
+    int getTileCount() const { return tilesX * tilesY; }
+    int getIslandCount() const { return islands.count(); }
+    int getStandaloneIslandCount() const { return static_cast<int>(standaloneIslands.size()); }
+    int getSleepingIslandCount() const;
+    
+    // validation runs - every updateIslands is checked against a full relabel, see cloth_headless --validate
+    void setIslandChecks(bool enabled) { islandChecks = enabled; }
+    int getIslandMismatches() const { return islandMismatches; }
     
     // setters (UI)
-    void setGravity(float g) { gravity = g; }
+    void setGravity(float g) { if (g != gravity) wakeAll(); gravity = g; }
     void setDamping(float d) { damping = d; }
     void setWindStrength(float w) { windStrength = w; }
     void setWindDirection(const glm::vec3& dir) { windDirection = glm::normalize(dir); }
-    void setTearThreshold(float t) { tearThreshold = t; }
+    void setWindGustiness(float amount) { windField.setGustiness(amount); }
+    void setAerodynamics(float drag, float lift) { aeroDrag = std::max(drag, 0.0f); aeroLift = std::max(lift, 0.0f); }
+    void setTearThreshold(float t) { if (t != tearThreshold) wakeAll(); tearThreshold = t; }
+    void setSolverMode(SolverMode mode);                   // leaves substeps and iterations as they are
+    void applyDefaultSplit();                              // substeps and iterations suited to the solver mode
+    void setParticleLayout(ParticleLayout order);          // rebuilds the cloth, call before setMode
+    void setSubsteps(int count) { if (std::max(count, 1) != substeps) wakeAll(); substeps = std::max(count, 1); }
+    void setSolverIterations(int count) {
+        if (std::max(count, 1) != solverIterations) wakeAll();
+        solverIterations = std::max(count, 1);
+    }
+    void setCompliance(Spring::SpringType type, float compliance);
+    void setFixedTimeStep(float seconds);
+    void setMaxStepsPerFrame(int count) { scheduler.setMaxStepsPerFrame(count); }
+    void setStepBudget(double seconds) { scheduler.setBudget(seconds); }
+    void setOverrunPolicy(OverrunPolicy policy) { scheduler.setPolicy(policy); }
+    void setSleeping(bool enabled) { sleepEnabled = enabled; if (!enabled) wakeAll(); }
+    // a lower threshold can leave sleeping tiles moving faster than it allows
+    void setSleepThreshold(float velocity) {
+        if (std::max(velocity, 0.0f) < sleepThreshold) wakeAll();
+        sleepThreshold = std::max(velocity, 0.0f);
+    }
+    void setCacheBlocking(bool enabled) { cacheBlocking = enabled; }
     
     // getters (UI)
     float getGravity() const { return gravity; }
     float getDamping() const { return damping; }
     float getWindStrength() const { return windStrength; }
     glm::vec3 getWindDirection() const { return windDirection; }
+    float getWindGustiness() const { return windField.getGustiness(); }
+    float getAeroDrag() const { return aeroDrag; }
+    float getAeroLift() const { return aeroLift; }
     float getTearThreshold() const { return tearThreshold; }
+    SolverMode getSolverMode() const { return solverMode; }
+    ParticleLayout getParticleLayout() const { return layout; }
+    int getSubsteps() const { return substeps; }
+    int getSolverIterations() const { return solverIterations; }
+    float getFixedTimeStep() const { return fixedTimeStep; }
+    int getMaxStepsPerFrame() const { return scheduler.getMaxStepsPerFrame(); }
+    double getStepBudget() const { return scheduler.getBudget(); }
+    OverrunPolicy getOverrunPolicy() const { return scheduler.getPolicy(); }
+    bool getSleeping() const { return sleepEnabled; }
+    float getSleepThreshold() const { return sleepThreshold; }
+    bool getCacheBlocking() const { return cacheBlocking; }
+    uint64_t getSkippedSteps() const { return scheduler.getSkippedSteps(); }
+    float getCompliance(Spring::SpringType type) const { return typeCompliance[type]; }
     
     // collision object manipulation
     void addSphere(const glm::vec3& center, float radius);
     void clearCollisionObjects();
+    void setSharedColliders(const std::vector<CollisionSphere>* colliders) { sharedColliders = colliders; }
+    void setSeed(uint32_t seed) { windSeed = seed; }
     
     // object movement for collision mode
     void updateObjectMovement(float deltaTime);
     
-    // wind variation for flag mode
+    // gust fronts move on with simulated time
     void updateWindVariation(float deltaTime);
     
 private:
     void createClothGrid();
     void applyForces();
+    void solveConstraints();
     void satisfyConstraints();
+    void updateIntactTiles();
+    void solveStencilPasses();
+    void solveStencilBlocks();
+    void solveColoredBatches();
+    void releaseTornSprings();
+    void rebuildColoring();
+    void solveStencilTile(int tile, int kindIndex, int parity);
+    void tearTile(int tile);
+    void colorTileSprings(int tile, bool solved);
+    void deactivateSpring(int index);
+    void compactSprings();
+    
+    // sleep state - wakeTiles runs before a step, updateSleep after it
+    void wakeTiles();
+    void updateSleep();
+    void wakeTile(int tile);
+    void wakeNeighborhood(int tile);
+    void wakeAll();
+    void sleepTile(int tile);
+    void updateParking(int tile);
+    bool neighborhoodSettled(int tile) const;
+    bool neighborhoodAsleep(int tile) const;
+    
+    // islands - updateIslands runs before a step, solveIslands after each substep's tile solve
+    void updateIslands();
+    void solveIslands();
+    void updateIslandSleep();
+    void wakeIsland(int island);
+    void sleepIsland(int island);
+    bool islandAsleep(int particle) const {
+        int island = islands.islandOf(particle);
+        return island >= 0 && islands[island].sleeping;
+    }
+    bool solvedAlone(int particle) const {
+        int island = islands.islandOf(particle);
+        return island >= 0 && islands[island].standalone;
+    }
     void handleCollisions();
     void updateVertexData();
+    void storeRenderState();
+    void rebuildMesh();
+    void removeParticleFromMesh(int index);
     void integrateVerlet(float deltaTime);
-    void applyWindForce(Particle& particle);
 
-    bool checkTearing(const Spring& spring);
+    bool solveSpring(Spring& spring);
+    bool checkTearing(const Spring& spring, float distance) const;
+    
+    // area weighted vertex normals, and with aerodynamics the lift/drag of every triangle from the
+    // same face normals - run once at the end of each step, reused for rendering
+    // only the tile rows in bandDirty are redone while part of the cloth sleeps
+    void computeNormals(bool aerodynamics = false);
+    void sampleWind();
+    
+    // tiled, every band of TILE_SIZE rows is the same block of the streams as row-major - inside it
+    // the tiles follow each other, row-major and clipped to the grid like the solver tiles
+    int particleIndex(int x, int y) const {
+        if (layout == ParticleLayout::ROWS) return y * gridWidth + x;
+        
+        int x0 = x & ~(TILE_SIZE - 1);
+        int y0 = y & ~(TILE_SIZE - 1);
+        int w = std::min(TILE_SIZE, gridWidth - x0);
+        int h = std::min(TILE_SIZE, gridHeight - y0);
+        return y0 * gridWidth + x0 * h + (y - y0) * w + (x - x0);
+    }
+    void gridCoords(int particle, int& x, int& y) const {
+        if (layout == ParticleLayout::ROWS) {
+            x = particle % gridWidth;
+            y = particle / gridWidth;
+            return;
+        }
+        
+        int y0 = particle / (TILE_SIZE * gridWidth) * TILE_SIZE;
+        int h = std::min(TILE_SIZE, gridHeight - y0);
+        int offset = particle - y0 * gridWidth;
+        int x0 = offset / (TILE_SIZE * h) * TILE_SIZE;
+        int w = std::min(TILE_SIZE, gridWidth - x0);
+        offset -= x0 * h;
+        x = x0 + offset % w;
+        y = y0 + offset / w;
+    }
+    int tileOf(int particle) const {
+        int x, y;
+        gridCoords(particle, x, y);
+        return (y / TILE_SIZE) * tilesX + x / TILE_SIZE;
+    }
     
-    glm::vec3 calculateNormal(int x, int y) const;
+    // the tile and its up to 8 neighbors
+    template <typename Visitor>
+    void forEachNeighborTile(int tile, Visitor&& visit) const {
+        int tx = tile % tilesX;
+        int ty = tile / tilesX;
+        for (int y = std::max(ty - 1, 0); y <= std::min(ty + 1, tilesY - 1); ++y) {
+            for (int x = std::max(tx - 1, 0); x <= std::min(tx + 1, tilesX - 1); ++x) {
+                visit(y * tilesX + x);
+            }
+        }
+    }
 };
 
 #endif 
@@ -0,0 +1,50 @@
+#ifndef CLOTH_WORLD_H
+#define CLOTH_WORLD_H
+
+#include "ClothSystem.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+// a scene of independent cloths that collide with the same shared spheres
+// update() steps every cloth - cloths holding more than their share of the work step one at a
+// time with their own parallel loops, the rest step concurrently, one cloth per task, with the
+// pool's work stealing evening out their different sizes
+class ClothWorld {
+private:
+    std::vector<std::unique_ptr<ClothSystem>> cloths;
+    std::vector<CollisionSphere> colliders;
+    ThreadPool* threadPool;
+    
+    // per update scratch
+    std::vector<ClothSystem*> concurrent;
+    
+public:
+    ClothWorld();
+    
+    ClothWorld(const ClothWorld&) = delete;
+    ClothWorld& operator=(const ClothWorld&) = delete;
+    
+    // origin is the middle of the cloth's bottom edge
+    ClothSystem& addCloth(int width, int height, float w, float h, const glm::vec3& origin);
+    void removeCloth(size_t index);
+    void clear();
+    
+    void update(float deltaTime);
+    
+    // colliders every cloth sees in addition to its own spheres
+    void addCollider(const glm::vec3& center, float radius);
+    void clearColliders();
+    std::vector<CollisionSphere>& getColliders() { return colliders; }
+    
+    size_t getClothCount() const { return cloths.size(); }
+    ClothSystem& getCloth(size_t index) { return *cloths[index]; }
+    const ClothSystem& getCloth(size_t index) const { return *cloths[index]; }
+    size_t getParticleCount() const;
+};
+
+#endif
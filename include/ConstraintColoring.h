@@ -0,0 +1,38 @@
+#ifndef CONSTRAINT_COLORING_H
+#define CONSTRAINT_COLORING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// partitions springs into color batches where no two springs of a batch share a particle,
+// so every batch can be solved in parallel
+// greedy coloring, kept up to date incrementally as springs are added and removed
+class ConstraintColoring {
+private:
+    static constexpr int MAX_COLORS = 64;
+
+    std::vector<uint64_t> particleColors;     // bit c set = an incident spring has color c
+    std::vector<int> springColor;             // -1 if the spring is not in a batch
+    std::vector<int> batchSlot;               // position inside its batch
+    std::vector<std::vector<int>> batches;
+    std::vector<int> batchEdits;              // adds and removes since the batch was last sorted
+
+public:
+    void reset(size_t particleCount, size_t springCount);
+
+    // assigns the lowest color free at both particles
+    void add(int spring, int particle1, int particle2);
+    void remove(int spring, int particle1, int particle2);
+
+    // puts batches that edits have shuffled by more than a quarter back in spring order - springs are
+    // stored by first particle, so a sorted batch walks the particles front to back
+    void sortStaleBatches();
+
+    bool contains(int spring) const { return springColor[spring] >= 0; }
+    int colorOf(int spring) const { return springColor[spring]; }
+
+    const std::vector<std::vector<int>>& getBatches() const { return batches; }
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef COUNTER_RANDOM_H
+#define COUNTER_RANDOM_H
+
+#include <cstdint>
+
+// stateless counter-based random numbers - a sample depends only on (key, counter), so
+// samples can be drawn in any order, on any thread and in any SIMD width with the same result
+// keys are derived from (seed, step, stream), counters are particle indices
+// the rounds use only 32-bit multiply, xor and shift so they map one to one onto vector lanes
+namespace CounterRandom {
+
+constexpr uint32_t GOLDEN = 0x9e3779b9u;
+constexpr uint32_t MIX_MUL1 = 0x7feb352du;
+constexpr uint32_t MIX_MUL2 = 0x846ca68bu;
+
+// bijective 32-bit finalizer with full avalanche
+inline uint32_t mix(uint32_t x) {
+    x ^= x >> 16;
+    x *= MIX_MUL1;
+    x ^= x >> 15;
+    x *= MIX_MUL2;
+    x ^= x >> 16;
+    return x;
+}
+
+// one key per (seed, step, stream), computed once per step
+inline uint32_t key(uint32_t seed, uint64_t step, uint32_t stream) {
+    uint32_t h = mix(seed ^ GOLDEN);
+    h = mix(h ^ static_cast<uint32_t>(step));
+    h = mix(h ^ static_cast<uint32_t>(step >> 32));
+    return mix(h ^ stream);
+}
+
+// two keyed rounds per sample
+inline uint32_t bits(uint32_t key, uint32_t counter) {
+    return mix(mix(counter ^ key) + key);
+}
+
+// uniform in [-1, 1) from the top 24 bits - exact in float, so every SIMD level agrees bit for bit
+inline float signedUnit(uint32_t bits) {
+    return static_cast<float>(static_cast<int32_t>(bits >> 8)) * (1.0f / 8388608.0f) - 1.0f;
+}
+
+} // namespace CounterRandom
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef PARTICLE_STORE_H
+#define PARTICLE_STORE_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// cache line aligned allocator so every particle stream starts on a 64 byte boundary
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* ptr, std::size_t) noexcept {
+        ::operator delete(ptr, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// structure-of-arrays particle storage
+// streams are padded to a multiple of LANE_PADDING so vector kernels never need a scalar tail,
+// padding lanes are inactive and never move
+class ParticleStore {
+public:
+    static constexpr std::size_t LANE_PADDING = 16;     // floats per AVX-512 register
+
+    // current and previous (verlet) positions
+    AlignedVector<float> x, y, z;
+    AlignedVector<float> prevX, prevY, prevZ;
+
+    // force accumulated for the current step
+    AlignedVector<float> forceX, forceY, forceZ;
+
+    AlignedVector<float> invMass;
+
+    // packed flags, one bit per particle
+    std::vector<std::uint64_t> pinnedBits;
+    std::vector<std::uint64_t> activeBits;
+    std::vector<std::uint64_t> sleepingBits;    // at rest, held in place until woken
+
+    void resize(std::size_t particleCount) {
+        count = particleCount;
+        std::size_t padded = (count + LANE_PADDING - 1) / LANE_PADDING * LANE_PADDING;
+
+        for (AlignedVector<float>* stream : { &x, &y, &z, &prevX, &prevY, &prevZ, &forceX, &forceY, &forceZ }) {
+            stream->assign(padded, 0.0f);
+        }
+        invMass.assign(padded, 1.0f);
+
+        std::size_t words = (padded + 63) / 64;
+        pinnedBits.assign(words, 0);
+        activeBits.assign(words, 0);
+        sleepingBits.assign(words, 0);
+        for (std::size_t i = 0; i < count; ++i) {
+            activeBits[i >> 6] |= std::uint64_t(1) << (i & 63);
+        }
+    }
+
+    void clear() { resize(0); }
+
+    std::size_t size() const { return count; }
+    std::size_t paddedSize() const { return x.size(); }
+
+    glm::vec3 position(std::size_t i) const { return glm::vec3(x[i], y[i], z[i]); }
+    glm::vec3 previousPosition(std::size_t i) const { return glm::vec3(prevX[i], prevY[i], prevZ[i]); }
+
+    void setPosition(std::size_t i, const glm::vec3& p) { x[i] = p.x; y[i] = p.y; z[i] = p.z; }
+    void setPreviousPosition(std::size_t i, const glm::vec3& p) { prevX[i] = p.x; prevY[i] = p.y; prevZ[i] = p.z; }
+
+    float mass(std::size_t i) const { return 1.0f / invMass[i]; }
+
+    bool isPinned(std::size_t i) const { return testBit(pinnedBits, i); }
+    bool isActive(std::size_t i) const { return testBit(activeBits, i); }
+    bool isSleeping(std::size_t i) const { return testBit(sleepingBits, i); }
+    void setPinned(std::size_t i, bool pinned) { assignBit(pinnedBits, i, pinned); }
+    void setActive(std::size_t i, bool active) { assignBit(activeBits, i, active); }
+    void setSleeping(std::size_t i, bool sleeping) { assignBit(sleepingBits, i, sleeping); }
+
+    // active, not pinned and awake, i.e. the particle is integrated
+    // constraints treat every other particle as having infinite mass
+    bool isFree(std::size_t i) const {
+        std::uint64_t word = activeBits[i >> 6] & ~pinnedBits[i >> 6] & ~sleepingBits[i >> 6];
+        return (word >> (i & 63)) & 1;
+    }
+
+    // visit(i) for every active particle that is awake, or also not pinned - one word test skips
+    // 64 removed or sleeping particles, which a torn or settled cloth has long runs of
+    template <typename Visitor>
+    void forEachAwake(Visitor&& visit) const {
+        for (std::size_t w = 0; w < activeBits.size(); ++w) {
+            visitBits(w, activeBits[w] & ~sleepingBits[w], visit);
+        }
+    }
+
+    template <typename Visitor>
+    void forEachFree(Visitor&& visit) const {
+        for (std::size_t w = 0; w < activeBits.size(); ++w) {
+            visitBits(w, activeBits[w] & ~pinnedBits[w] & ~sleepingBits[w], visit);
+        }
+    }
+
+private:
+    std::size_t count = 0;
+
+    static bool testBit(const std::vector<std::uint64_t>& bits, std::size_t i) {
+        return (bits[i >> 6] >> (i & 63)) & 1;
+    }
+
+    static void assignBit(std::vector<std::uint64_t>& bits, std::size_t i, bool value) {
+        std::uint64_t mask = std::uint64_t(1) << (i & 63);
+        if (value) bits[i >> 6] |= mask;
+        else       bits[i >> 6] &= ~mask;
+    }
+
+    template <typename Visitor>
+    static void visitBits(std::size_t w, std::uint64_t word, Visitor& visit) {
+        for (; word; word &= word - 1) {
+            visit((w << 6) + lowestBit(word));
+        }
+    }
+
+    static std::size_t lowestBit(std::uint64_t word) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return index;
+#else
+        return static_cast<std::size_t>(__builtin_ctzll(word));
+#endif
+    }
+};
+
+#endif
@@ -1,18 +1,22 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include "StreamBuffer.h"
+#include "VertexRing.h"
+
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <memory>
 
 
 class Camera;
-class ClothSystem;
+struct ClothSnapshot;
 
 class Shader {
 private:
@@ -62,8 +66,21 @@ private:
     std::unique_ptr<Skybox> skybox;
     
     // cloth rendering
-    unsigned int clothVAO, clothVBO, clothEBO;
+    unsigned int clothVAO, clothEBO, clothTexCoordVBO;
+    std::unique_ptr<StreamBuffer> clothPositions;      // copy path, rewritten every frame
+    std::unique_ptr<StreamBuffer> clothPreviousPositions;
+    std::unique_ptr<StreamBuffer> clothNormals;
+    
+    // memory the simulation thread writes vertex streams into, see VertexRing
+    VertexRing* vertexRing = nullptr;
+    unsigned int vertexRingBuffer = 0;
+    GLsync vertexRingFences[VertexRing::REGIONS] = {};
+    uint64_t vertexRingFenced[VertexRing::REGIONS] = {};    // sequence each fence covers
+    uint64_t vertexRingDrawn = 0;                           // newest sequence drawn
     unsigned int clothTexture;
+    uint64_t clothTopologyVersion = 0;      // of the indices and texture coords currently uploaded
+    bool clothTopologyUploaded = false;
+    uint64_t clothRenderVersion = 0;        // of the positions and normals in the current stream regions
     
     // collision object rendering
     unsigned int sphereVAO, sphereVBO, sphereEBO;
@@ -77,14 +94,19 @@ public:
     ~Renderer();
     
     bool initialize();
-    void createScene(const ClothSystem& cloth, const Camera& camera, bool wireframe);
+    // needs ARB_buffer_storage, without it the snapshots keep their own copy
+    void attachVertexRing(VertexRing& ring, size_t vertexCapacity);
+    // alpha blends the snapshot's previous step into its current one
+    void createScene(const ClothSnapshot& cloth, const Camera& camera, bool wireframe, float alpha);
     void cleanup();
     
 private:
     void setupClothBuffers();
     void setupCollisionObjectBuffers();
-    void renderCloth(const ClothSystem& cloth, const Camera& camera, bool wireframe);
-    void renderCollisionObjects(const ClothSystem& cloth, const Camera& camera);
+    void renderCloth(const ClothSnapshot& cloth, const Camera& camera, bool wireframe, float alpha);
+    void renderCollisionObjects(const ClothSnapshot& cloth, const Camera& camera, float alpha);
+    void bindClothStreams(const ClothSnapshot& cloth);
+    void fenceClothStreams(const ClothSnapshot& cloth);
     void generateSphereMesh(float radius, int segments);
     
     // embedded shaders
@@ -0,0 +1,64 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+class ParticleStore;
+
+enum class SimdLevel {
+    SCALAR,
+    SSE42,
+    AVX2,
+    AVX512
+};
+
+// wind velocity at time t: base + sum over fronts of push * pulse(dot(wave, p) + phase)
+// pulse(s) = (4u(1 - u))^2 with u = fract(s), one smooth gust per unit of s
+// built by WindField, which folds the travel time into phase
+struct GustField {
+    static constexpr int MAX_FRONTS = 4;
+
+    int frontCount = 0;
+    float baseX = 0.0f, baseY = 0.0f, baseZ = 0.0f;
+    float waveX[MAX_FRONTS], waveY[MAX_FRONTS], waveZ[MAX_FRONTS];     // travel direction / wavelength
+    float phase[MAX_FRONTS];                                            // in [0, 1)
+    float pushX[MAX_FRONTS], pushY[MAX_FRONTS], pushZ[MAX_FRONTS];     // velocity added at a gust's peak
+};
+
+// per-particle turbulence for one fixed step, added on top of the sampled wind
+// drawn from CounterRandom keyed per axis, with the particle index as counter
+struct WindTurbulence {
+    float amplitudeX, amplitudeY, amplitudeZ;
+    uint32_t keyX, keyY, keyZ;
+};
+
+// per-particle kernels over the SoA store, one implementation per instruction set
+// the widest level supported by the CPU is picked once at startup, the CLOTH_SIMD
+// environment variable (scalar, sse4.2, avx2, avx512) can force a lower one
+struct ParticleKernels {
+    SimdLevel level;
+
+    // force = (0, gravity * mass, 0) for every free particle
+    void (*applyGravity)(ParticleStore& particles, float gravity);
+
+    // position += (position - previous) * damping + force / mass * dt^2 for every free particle
+    void (*integrateVerlet)(ParticleStore& particles, float damping, float deltaTime);
+
+    // gust field velocity at count SoA positions - 64 byte aligned streams padded to a multiple of 16
+    // no FMA so every level produces the same bits as the scalar one
+    void (*sampleWind)(const GustField& field, const float* x, const float* y, const float* z,
+                       float* velocityX, float* velocityY, float* velocityZ, std::size_t count);
+
+    // velocity += turbulence for [begin, end) of velocity streams indexed like the store
+    // begin is a multiple of 16, bit-for-bit the same at every level like sampleWind
+    void (*addTurbulence)(const WindTurbulence& turbulence, float* velocityX, float* velocityY, float* velocityZ,
+                          std::size_t begin, std::size_t end);
+
+    static const ParticleKernels& get();
+    static const ParticleKernels& forLevel(SimdLevel level);
+    static SimdLevel detectLevel();
+    static const char* levelName(SimdLevel level);
+};
+
+#endif
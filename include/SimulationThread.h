@@ -0,0 +1,127 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include "ClothSystem.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include "VertexRing.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// everything the render thread and UI read from one completed step
+struct ClothSnapshot {
+    using Clock = std::chrono::steady_clock;
+    
+    // vertex streams - in a region of the render thread's VertexRing, or copied into the vectors
+    // below when no region was free (or the ring is not attached yet)
+    size_t vertexCount = 0;
+    uint64_t vertexSequence = 0;            // VertexRing sequence holding the streams, 0 = in the vectors
+    std::vector<float> positions;           // 3 per render vertex
+    std::vector<float> previousPositions;   // at the start of the last step, 3 per render vertex
+    std::vector<float> normals;             // 3 per render vertex
+    uint64_t renderVersion = 0;             // vertex streams are only rewritten when this or the topology changes
+    bool atRest = false;                    // previous and current positions are equal, alpha does not matter
+    
+    // only copied into a slot when the topology changed since that slot was last filled
+    std::vector<float> texCoords;           // 2 per render vertex
+    std::vector<unsigned int> indices;
+    uint64_t topologyVersion = 0;
+    
+    std::vector<CollisionSphere> spheres;
+    std::vector<glm::vec3> previousSphereCenters;
+    size_t activeParticles = 0;
+    int sleepingTiles = 0;
+    int tileCount = 0;
+    int islandCount = 0;
+    int sleepingIslands = 0;
+    
+    // interpolation between previous and current state, see alphaAt
+    float alpha = 1.0f;                     // when published
+    float fixedTimeStep = 1.0f / 60.0f;
+    Clock::time_point publishTime;
+    bool advancing = false;                 // false while paused, alpha then stays put
+    
+    // parameters the step ran with
+    float gravity = 0.0f;
+    float damping = 0.0f;
+    float windStrength = 0.0f;
+    glm::vec3 windDirection = glm::vec3(0.0f);
+    float windGustiness = 0.0f;
+    float tearThreshold = 0.0f;
+    SolverMode solverMode = SolverMode::PBD;
+    int substeps = 1;
+    int solverIterations = 1;
+    int maxStepsPerFrame = 1;
+    OverrunPolicy overrunPolicy = OverrunPolicy::DROP;
+    uint64_t skippedSteps = 0;
+    float physicsRate = 60.0f;              // fixed steps per simulated second
+    
+    size_t getVertexCount() const { return vertexCount; }
+    
+    // blend factor for a frame shown at time now - simulated time moves on after publishing
+    float alphaAt(Clock::time_point now) const {
+        float later = advancing ? std::chrono::duration<float>(now - publishTime).count() / fixedTimeStep : 0.0f;
+        return std::min(std::max(alpha + later, 0.0f), 1.0f);
+    }
+};
+
+// steps a ClothSystem on its own thread, in real time
+// the cloth is only ever touched by that thread - other threads change it through submitted
+// commands and read it through the snapshot of the last completed step
+class SimulationThread {
+public:
+    using Command = std::function<void(ClothSystem&)>;
+    
+private:
+    static constexpr size_t COMMAND_CAPACITY = 256;
+    
+    std::unique_ptr<ClothSystem> cloth;
+    
+    TripleBuffer<ClothSnapshot> snapshots;
+    VertexRing vertexRing;
+    uint64_t ringSequence = 0;              // last region written, 0 = the last streams went into a slot
+    uint64_t ringRenderVersion = 0;         // versions of the streams in that region
+    uint64_t ringTopologyVersion = 0;
+    SpscQueue<Command, COMMAND_CAPACITY> commands;      // single producer, the UI thread
+    
+    std::atomic<bool> running{false};
+    std::atomic<bool> paused{false};
+    std::thread thread;
+    
+public:
+    explicit SimulationThread(std::unique_ptr<ClothSystem> cloth);
+    ~SimulationThread();
+    
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+    
+    void start();
+    void stop();
+    
+    // runs on the simulation thread before its next step, in submission order
+    void submit(Command command);
+    
+    void setPaused(bool pause) { paused.store(pause, std::memory_order_relaxed); }
+    bool isPaused() const { return paused.load(std::memory_order_relaxed); }
+    
+    // newest completed snapshot, valid until the next call - consumer thread only
+    const ClothSnapshot& acquire();
+    
+    // the render thread attaches its mapped memory and reports what it still reads
+    VertexRing& getVertexRing() { return vertexRing; }
+    
+private:
+    void run();
+    void publish();
+    void writeStreams(ClothSnapshot& snapshot);
+};
+
+#endif
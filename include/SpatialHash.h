@@ -0,0 +1,75 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include "ParticleStore.h"
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// uniform grid over active particle positions, hashed into a fixed table and stored CSR style
+// radius queries only visit the cells overlapping the query sphere
+class SpatialHash {
+private:
+    float invCellSize = 1.0f;
+    uint32_t tableMask = 0;
+    std::vector<int> cellStart;     // bucket -> first entry, tableSize + 1 entries
+    std::vector<int> entries;       // particle indices grouped by bucket
+
+public:
+    void build(const ParticleStore& particles, float cellSize);
+
+    // calls visit(index) for every indexed particle within radius of center
+    template <typename Visitor>
+    void forEachInRadius(const ParticleStore& particles, const glm::vec3& center, float radius, Visitor&& visit) const;
+
+private:
+    int cellCoord(float value) const { return static_cast<int>(std::floor(value * invCellSize)); }
+
+    uint32_t bucketOf(int x, int y, int z) const {
+        uint32_t h = (uint32_t(x) * 73856093u) ^ (uint32_t(y) * 19349663u) ^ (uint32_t(z) * 83492791u);
+        return h & tableMask;
+    }
+};
+
+template <typename Visitor>
+void SpatialHash::forEachInRadius(const ParticleStore& particles, const glm::vec3& center, float radius, Visitor&& visit) const {
+    if (entries.empty()) return;
+
+    int x0 = cellCoord(center.x - radius), x1 = cellCoord(center.x + radius);
+    int y0 = cellCoord(center.y - radius), y1 = cellCoord(center.y + radius);
+    int z0 = cellCoord(center.z - radius), z1 = cellCoord(center.z + radius);
+    float radiusSq = radius * radius;
+
+    // different cells can hash to the same bucket, visit each bucket once
+    uint32_t visited[27];
+    int visitedCount = 0;
+
+    for (int z = z0; z <= z1; ++z) {
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                uint32_t bucket = bucketOf(x, y, z);
+
+                bool seen = false;
+                for (int i = 0; i < visitedCount; ++i) {
+                    if (visited[i] == bucket) { seen = true; break; }
+                }
+                if (seen) continue;
+                if (visitedCount < 27) visited[visitedCount++] = bucket;
+
+                for (int e = cellStart[bucket]; e < cellStart[bucket + 1]; ++e) {
+                    int index = entries[e];
+                    float dx = particles.x[index] - center.x;
+                    float dy = particles.y[index] - center.y;
+                    float dz = particles.z[index] - center.z;
+                    if (dx * dx + dy * dy + dz * dz < radiusSq) {
+                        visit(index);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SPRING_INCIDENCE_H
+#define SPRING_INCIDENCE_H
+
+#include <cstddef>
+#include <vector>
+
+struct Spring;
+
+// CSR adjacency from each particle to its incident springs
+// live springs are kept at the front of each row, so tearing removes a spring in O(degree)
+class SpringIncidence {
+private:
+    std::vector<int> offsets;       // row start per particle, particleCount + 1 entries
+    std::vector<int> liveCounts;    // active springs at the front of each row
+    std::vector<int> springIds;
+
+public:
+    struct Range {
+        const int* first;
+        const int* last;
+        
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+        bool empty() const { return first == last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    void build(size_t particleCount, const std::vector<Spring>& springs);
+    void remove(int spring, int particle1, int particle2);
+
+    // active springs touching the particle
+    Range springsOf(int particle) const {
+        const int* row = springIds.data() + offsets[particle];
+        return { row, row + liveCounts[particle] };
+    }
+
+private:
+    void removeFromRow(int particle, int spring);
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// bounded lock-free queue for exactly one producer thread and one consumer thread
+template <typename T, size_t Capacity>
+class SpscQueue {
+private:
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static constexpr size_t MASK = Capacity - 1;
+
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> head{0};    // next item to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0};    // next free slot, written by the producer
+
+public:
+    // producer side - leaves item untouched and returns false when full
+    bool push(T&& item) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - head.load(std::memory_order_acquire) == Capacity) return false;
+
+        items[position & MASK] = std::move(item);
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    bool pop(T& item) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == tail.load(std::memory_order_acquire)) return false;
+
+        item = std::move(items[position & MASK]);
+        items[position & MASK] = T();
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif
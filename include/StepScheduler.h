@@ -0,0 +1,61 @@
+#ifndef STEP_SCHEDULER_H
+#define STEP_SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+
+// what to do with simulated time a frame could not step through
+enum class OverrunPolicy {
+    DROP,       // discard it - the sim falls behind the clock but never tries to catch up
+    SLOW        // carry it over, capped at one frame's worth of steps - overload shows as slow motion
+};
+
+// decides how many fixed steps each frame takes - at most maxStepsPerFrame and, past the
+// first step, only while the frame's wall-clock budget lasts, so a heavy scene degrades
+// instead of spiralling into ever longer frames
+class StepScheduler {
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    float fixedTimeStep;
+    float accumulator = 0.0f;
+    
+    int maxStepsPerFrame = 4;
+    double budget = 0.012;              // seconds of stepping per frame
+    OverrunPolicy policy = OverrunPolicy::DROP;
+    
+    // current frame
+    Clock::time_point frameStart;
+    int frameSteps = 0;
+    
+    int lastSkipped = 0;
+    uint64_t skippedSteps = 0;
+    
+public:
+    explicit StepScheduler(float fixedTimeStep);
+    
+    void beginFrame(float deltaTime);
+    // true while another step is due and allowed, the caller then runs exactly one step
+    bool nextStep();
+    // applies the overrun policy to the time left over
+    void endFrame();
+    
+    void reset();
+    
+    void setFixedTimeStep(float seconds) { fixedTimeStep = seconds; }
+    void setMaxStepsPerFrame(int count);
+    void setBudget(double seconds) { budget = seconds; }
+    void setPolicy(OverrunPolicy overrun) { policy = overrun; }
+    
+    int getMaxStepsPerFrame() const { return maxStepsPerFrame; }
+    double getBudget() const { return budget; }
+    OverrunPolicy getPolicy() const { return policy; }
+    
+    int getFrameSteps() const { return frameSteps; }            // steps taken by the last frame
+    int getLastSkipped() const { return lastSkipped; }          // steps the last frame gave up
+    uint64_t getSkippedSteps() const { return skippedSteps; }   // since the last reset
+    float getLeftoverTime() const { return accumulator; }       // simulated time not stepped through yet
+    float getFixedTimeStep() const { return fixedTimeStep; }
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+// vertex stream rewritten every frame - one GL buffer split into REGIONS regions that are
+// written in turn, persistently mapped so the CPU writes straight into driver memory
+// a fence per region makes sure a region is only reused once the GPU has drawn from it
+// without ARB_buffer_storage it falls back to a staging copy and glBufferSubData
+class StreamBuffer {
+public:
+    static constexpr int REGIONS = 3;
+
+private:
+    unsigned int buffer = 0;
+    size_t vertexSize;                  // bytes
+    size_t capacity = 0;                // vertices per region
+    int region = REGIONS - 1;           // region handed out by the last map()
+    
+    bool persistent = false;
+    void* mapped = nullptr;             // whole buffer, persistent path only
+    GLsync fences[REGIONS] = {};
+    std::vector<unsigned char> staging; // fallback path only
+    
+public:
+    explicit StreamBuffer(size_t vertexSize);
+    ~StreamBuffer();
+    
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+    
+    // grows the regions to hold at least vertexCount vertices, never shrinks
+    void reserve(size_t vertexCount);
+    
+    // next region to write, only blocks while the GPU is still reading it
+    void* map();
+    // makes the first vertexCount vertices written since map() visible to GL
+    void unmap(size_t vertexCount);
+    // call once the draws reading the current region are issued
+    void fence();
+    
+    void release();
+    
+    unsigned int getID() const { return buffer; }
+    size_t offset() const { return region * capacity * vertexSize; }    // of the current region, in bytes
+    bool isPersistent() const { return persistent; }
+};
+
+#endif
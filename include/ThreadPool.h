@@ -0,0 +1,67 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads for data-parallel loops
+// the calling thread takes part in every loop, nested loops run inline on the calling thread
+// each participant starts on its own contiguous share of the chunks and, once that runs dry,
+// steals the back half of another participant's remaining share
+class ThreadPool {
+private:
+    using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+    // remaining chunks [begin, end) of one participant, packed so that taking from the
+    // front (owner) and splitting off the back (thief) are each a single CAS
+    struct alignas(64) ChunkRange {
+        std::atomic<uint64_t> packed{0};
+    };
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<ChunkRange[]> ranges;       // slot 0 is the calling thread
+
+    std::mutex submitMutex;         // one loop in flight at a time
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    // current loop
+    const RangeFunction* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobGrain = 1;
+    size_t busyWorkers = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // threads that execute loop bodies, including the caller
+    size_t size() const { return workers.size() + 1; }
+
+    // calls body on [begin, end) chunks of at most grainSize covering [0, count), returns when all are done
+    void parallelFor(size_t count, size_t grainSize, const RangeFunction& body);
+
+    // process-wide pool sized to the hardware
+    static ThreadPool& shared();
+
+private:
+    void workerLoop(size_t slot);
+    void runChunks(size_t slot);
+    bool takeChunk(size_t slot, size_t& chunk);
+    bool stealChunks(size_t slot);
+};
+
+#endif
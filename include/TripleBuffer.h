@@ -0,0 +1,41 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// lock-free handoff of the latest value from one producer thread to one consumer thread
+// the producer fills its back slot and swaps it with the shared middle slot, the consumer
+// swaps the middle slot with its front slot whenever something new was published
+// neither side ever waits, the consumer keeps the last value it took until a newer one arrives
+template <typename T>
+class TripleBuffer {
+private:
+    static constexpr uint8_t INDEX_MASK = 3;
+    static constexpr uint8_t FRESH = 4;         // middle slot holds a value the consumer has not taken
+
+    T slots[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0;                           // producer only
+    uint8_t front = 2;                          // consumer only
+
+public:
+    // producer side
+    T& writeSlot() { return slots[back]; }
+    void publish() {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel);
+        back = previous & INDEX_MASK;
+    }
+
+    // consumer side - returns whether a newer value was taken
+    bool consume() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+
+        uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & INDEX_MASK;
+        return true;
+    }
+    const T& readSlot() const { return slots[front]; }
+};
+
+#endif
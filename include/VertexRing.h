@@ -0,0 +1,58 @@
+#ifndef VERTEX_RING_H
+#define VERTEX_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// vertex streams the simulation thread writes straight into memory the GPU draws from
+// REGIONS regions are written in turn, each write tagged with the next sequence number; the render
+// thread reports the oldest sequence it or the GPU may still read and the writer only reuses a
+// region whose last write is older than that - the sequence is all a snapshot has to carry
+// the render thread attaches the memory, until then, and whenever no region is free or the
+// vertices do not fit, nextSequence returns 0 and the writer keeps its own copy instead
+class VertexRing {
+public:
+    static constexpr int REGIONS = 4;           // drawn, two frames in flight on the GPU, being written
+    static constexpr size_t STREAMS = 9;        // floats per vertex - previous position, position, normal
+
+    struct Region {
+        float* previousPositions;
+        float* positions;
+        float* normals;
+    };
+
+private:
+    std::atomic<float*> memory{nullptr};
+    size_t capacity = 0;                        // vertices per region, set before memory is published
+    std::atomic<uint64_t> oldestInUse{1};       // reader - lower sequences are never read again
+    uint64_t lastWritten = 0;                   // writer only
+
+public:
+    // reader side - REGIONS * vertexCapacity * STREAMS floats that stay mapped while writes can happen
+    void attach(float* base, size_t vertexCapacity) {
+        capacity = vertexCapacity;
+        memory.store(base, std::memory_order_release);
+    }
+    void release(uint64_t oldestSequence) { oldestInUse.store(oldestSequence, std::memory_order_release); }
+
+    // writer side - the sequence to write next, 0 if there is nothing to write into
+    uint64_t nextSequence(size_t vertexCount) const {
+        if (!memory.load(std::memory_order_acquire) || vertexCount > capacity) return 0;
+
+        uint64_t next = lastWritten + 1;
+        return next < oldestInUse.load(std::memory_order_acquire) + REGIONS ? next : 0;
+    }
+    void written(uint64_t sequence) { lastWritten = sequence; }
+
+    // either side, for a sequence nextSequence handed out
+    static int regionOf(uint64_t sequence) { return static_cast<int>(sequence % REGIONS); }
+    size_t offsetOf(uint64_t sequence) const { return regionOf(sequence) * capacity * STREAMS; }     // floats
+    size_t getCapacity() const { return capacity; }
+    Region region(uint64_t sequence) const {
+        float* base = memory.load(std::memory_order_acquire) + offsetOf(sequence);
+        return { base, base + 3 * capacity, base + 6 * capacity };
+    }
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef WIND_FIELD_H
+#define WIND_FIELD_H
+
+#include "SimdKernels.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+
+// spatially coherent wind - a steady base flow plus a few gust fronts, each a train of smooth
+// pulses travelling through space, so a gust visibly sweeps across the cloth
+// sampled in SoA batches by the SIMD kernels, see GustField for the exact formula
+class WindField {
+private:
+    glm::vec3 direction = glm::vec3(1.0f, 0.0f, 0.0f);
+    float strength = 0.0f;
+    float gustiness = 0.5f;                         // gust peak relative to strength, 0 = steady
+
+    float frontPhase[GustField::MAX_FRONTS];        // cycles each front has moved on, in [0, 1)
+    GustField field;
+
+    const ParticleKernels* kernels;
+
+    void rebuild();
+
+public:
+    WindField();
+
+    void setBase(const glm::vec3& windDirection, float windStrength);
+    void setGustiness(float amount);
+
+    // moves the fronts downwind by deltaTime of simulated time
+    void advance(float deltaTime);
+    void reset();
+
+    // velocity at count positions - streams 64 byte aligned and padded to a multiple of 16
+    void sample(const float* x, const float* y, const float* z,
+                float* velocityX, float* velocityY, float* velocityZ, size_t count) const;
+
+    float getGustiness() const { return gustiness; }
+    const GustField& getField() const { return field; }
+};
+
+#endif
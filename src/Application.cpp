@@ -1,7 +1,9 @@
 #include "Application.h"
 #include "ClothSystem.h"
+#include "SimulationThread.h"
 #include "Renderer.h"
 #include "Camera.h"
+#include "SimdKernels.h"
 
 #include <imgui/imgui.h>
 #include <imgui/backends/imgui_impl_glfw.h>
@@ -84,9 +86,15 @@ bool Application::initializeGraphics() {
 }
 
 bool Application::initializePhysics() {
-    // cloth system initialization
-    clothSystem = std::make_unique<ClothSystem>(25, 25, 4.0f, 4.0f);
+    // cloth system initialization, stepped on its own thread from here on
+    auto clothSystem = std::make_unique<ClothSystem>(25, 25, 4.0f, 4.0f);
     clothSystem->setMode(currentMode);
+    size_t particleCount = clothSystem->getParticleCount();
+    
+    // the simulation writes vertex streams straight into the renderer's mapped memory
+    simulation = std::make_unique<SimulationThread>(std::move(clothSystem));
+    renderer->attachVertexRing(simulation->getVertexRing(), particleCount);
+    simulation->start();
     
     return true;
 }
@@ -128,6 +136,7 @@ void Application::printSystemInfo() {
     std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << '\n';
     std::cout << "Renderer: " << glGetString(GL_RENDERER) << '\n';
     std::cout << "Vendor: " << glGetString(GL_VENDOR) << '\n';
+    std::cout << "SIMD: " << ParticleKernels::levelName(ParticleKernels::get().level) << '\n';
 }
 
 void Application::run() {
@@ -140,9 +149,8 @@ void Application::run() {
         
         updatePerformanceStats(deltaTime);
         
-        if (!paused) {
-            update(deltaTime);
-        }
+        // the simulation steps on its own, rendering just picks up its newest result
+        snapshot = &simulation->acquire();
         
         render();
         
@@ -151,12 +159,6 @@ void Application::run() {
     }
 }
 
-void Application::update(float deltaTime) {
-    deltaTime = std::min(deltaTime, 0.016f); // max 60 FPS
-    
-    clothSystem->update(deltaTime);
-}
-
 void Application::render() {
     glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -166,7 +168,8 @@ void Application::render() {
     glfwGetFramebufferSize(window, &width, &height);
     glViewport(0, 0, width, height);
     
-    renderer->createScene(*clothSystem, *camera, wireframe);
+    float alpha = snapshot->alphaAt(ClothSnapshot::Clock::now());
+    renderer->createScene(*snapshot, *camera, wireframe, alpha);
     
     if (showUI) {
         renderUI();
@@ -195,19 +198,18 @@ void Application::renderSimulationControls() {
     const char* modeNames[] = { "Tear Mode", "Collision Mode", "Flag Mode" };
     int currentModeInt = static_cast<int>(currentMode);
     if (ImGui::Combo("Simulation Mode", &currentModeInt, modeNames, 3)) {
-        currentMode = static_cast<SimulationMode>(currentModeInt);
-        clothSystem->setMode(currentMode);
+        setMode(static_cast<SimulationMode>(currentModeInt));
     }
     
     ImGui::Separator();
     
     if (ImGui::Button("Reset Simulation")) {
-        clothSystem->reset();
+        resetSimulation();
     }
     
     ImGui::SameLine();
     if (ImGui::Button(paused ? "Resume" : "Pause")) {
-        paused = !paused;
+        togglePause();
     }
     
     ImGui::End();
@@ -216,33 +218,91 @@ void Application::renderSimulationControls() {
 void Application::renderPhysicsParameters() {
     ImGui::Begin("Physics Parameters");
     
-    float gravity = clothSystem->getGravity();
+    // values shown are the ones the last step ran with, changes apply from the next step
+    float gravity = snapshot->gravity;
     if (ImGui::SliderFloat("Gravity", &gravity, -20.0f, 0.0f)) {
-        clothSystem->setGravity(gravity);
+        simulation->submit([gravity](ClothSystem& cloth) { cloth.setGravity(gravity); });
     }
     
-    float damping = clothSystem->getDamping();
+    float damping = snapshot->damping;
     if (ImGui::SliderFloat("Damping", &damping, 0.9f, 1.0f)) {
-        clothSystem->setDamping(damping);
+        simulation->submit([damping](ClothSystem& cloth) { cloth.setDamping(damping); });
+    }
+    
+    ImGui::Separator();
+    
+    // constraint solver
+    const char* solverNames[] = { "PBD", "XPBD" };
+    int solverModeInt = static_cast<int>(snapshot->solverMode);
+    if (ImGui::Combo("Solver", &solverModeInt, solverNames, 2)) {
+        SolverMode solverMode = static_cast<SolverMode>(solverModeInt);
+        simulation->submit([solverMode](ClothSystem& cloth) { cloth.setSolverMode(solverMode); });
     }
     
+    // the split below is kept across solver switches
+    if (ImGui::Button("Default Split")) {
+        simulation->submit([](ClothSystem& cloth) { cloth.applyDefaultSplit(); });
+    }
+    
+    int substeps = snapshot->substeps;
+    if (ImGui::SliderInt("Substeps", &substeps, 1, 16)) {
+        simulation->submit([substeps](ClothSystem& cloth) { cloth.setSubsteps(substeps); });
+    }
+    
+    int iterations = snapshot->solverIterations;
+    if (ImGui::SliderInt("Iterations", &iterations, 1, 10)) {
+        simulation->submit([iterations](ClothSystem& cloth) { cloth.setSolverIterations(iterations); });
+    }
+    
+    ImGui::Separator();
+    
+    // rendering interpolates between steps, so the physics rate can sit below the display rate
+    const char* rateNames[] = { "30 Hz", "60 Hz", "120 Hz" };
+    const float rates[] = { 30.0f, 60.0f, 120.0f };
+    int rateIndex = snapshot->physicsRate < 45.0f ? 0 : (snapshot->physicsRate < 90.0f ? 1 : 2);
+    if (ImGui::Combo("Physics Rate", &rateIndex, rateNames, 3)) {
+        float timeStep = 1.0f / rates[rateIndex];
+        simulation->submit([timeStep](ClothSystem& cloth) { cloth.setFixedTimeStep(timeStep); });
+    }
+    
+    // step scheduling under load
+    int maxSteps = snapshot->maxStepsPerFrame;
+    if (ImGui::SliderInt("Max Steps/Frame", &maxSteps, 1, 16)) {
+        simulation->submit([maxSteps](ClothSystem& cloth) { cloth.setMaxStepsPerFrame(maxSteps); });
+    }
+    
+    const char* overrunNames[] = { "Drop Time", "Slow Down" };
+    int overrunInt = static_cast<int>(snapshot->overrunPolicy);
+    if (ImGui::Combo("Overrun", &overrunInt, overrunNames, 2)) {
+        OverrunPolicy overrun = static_cast<OverrunPolicy>(overrunInt);
+        simulation->submit([overrun](ClothSystem& cloth) { cloth.setOverrunPolicy(overrun); });
+    }
+    
+    ImGui::Separator();
+    
     if (currentMode == SimulationMode::FLAG) {
-        float windStrength = clothSystem->getWindStrength();
+        float windStrength = snapshot->windStrength;
         if (ImGui::SliderFloat("Wind Strength", &windStrength, 0.0f, 15.0f)) {
-            clothSystem->setWindStrength(windStrength);
+            simulation->submit([windStrength](ClothSystem& cloth) { cloth.setWindStrength(windStrength); });
         }
         
-        glm::vec3 windDir = clothSystem->getWindDirection();
+        glm::vec3 windDir = snapshot->windDirection;
         float windDirArray[3] = { windDir.x, windDir.y, windDir.z };
         if (ImGui::SliderFloat3("Wind Direction", windDirArray, -1.0f, 1.0f)) {
-            clothSystem->setWindDirection(glm::vec3(windDirArray[0], windDirArray[1], windDirArray[2]));
+            glm::vec3 direction(windDirArray[0], windDirArray[1], windDirArray[2]);
+            simulation->submit([direction](ClothSystem& cloth) { cloth.setWindDirection(direction); });
+        }
+        
+        float gustiness = snapshot->windGustiness;
+        if (ImGui::SliderFloat("Gustiness", &gustiness, 0.0f, 1.0f)) {
+            simulation->submit([gustiness](ClothSystem& cloth) { cloth.setWindGustiness(gustiness); });
         }
     }
     
     if (currentMode == SimulationMode::TEAR) {
-        float tearThreshold = clothSystem->getTearThreshold();
+        float tearThreshold = snapshot->tearThreshold;
         if (ImGui::SliderFloat("Tear Threshold", &tearThreshold, 1.5f, 5.0f)) {
-            clothSystem->setTearThreshold(tearThreshold);
+            simulation->submit([tearThreshold](ClothSystem& cloth) { cloth.setTearThreshold(tearThreshold); });
         }
     }
     
@@ -267,8 +327,11 @@ void Application::renderPerformanceInfo() {
     
     ImGui::Text("FPS: %.1f", averageFPS);
     ImGui::Text("Frame Time: %.3f ms", frameTime * 1000.0f);
-    ImGui::Text("Particles: %zu", clothSystem->getVertices().size() / 8); // 8 floats per vertex
-    ImGui::Text("Triangles: %zu", clothSystem->getIndices().size() / 3);
+    ImGui::Text("Particles: %zu", snapshot->activeParticles);
+    ImGui::Text("Sleeping Tiles: %d / %d", snapshot->sleepingTiles, snapshot->tileCount);
+    ImGui::Text("Islands: %d (%d asleep)", snapshot->islandCount, snapshot->sleepingIslands);
+    ImGui::Text("Triangles: %zu", snapshot->indices.size() / 3);
+    ImGui::Text("Skipped Steps: %llu", static_cast<unsigned long long>(snapshot->skippedSteps));
     
     ImGui::End();
 }
@@ -336,18 +399,34 @@ glm::vec3 Application::screenToWorldPos(double screenX, double screenY) {
 void Application::handleClothInteraction(double mouseX, double mouseY) {
     if (currentMode == SimulationMode::TEAR) {
         glm::vec3 worldPos = screenToWorldPos(mouseX, mouseY);
-        clothSystem->handleMouseInteraction(worldPos, true);
+        simulation->submit([worldPos](ClothSystem& cloth) { cloth.handleMouseInteraction(worldPos, true); });
     }
 }
 
+void Application::setMode(SimulationMode mode) {
+    currentMode = mode;
+    simulation->submit([mode](ClothSystem& cloth) { cloth.setMode(mode); });
+}
+
+void Application::resetSimulation() {
+    simulation->submit([](ClothSystem& cloth) { cloth.reset(); });
+}
+
+void Application::togglePause() {
+    paused = !paused;
+    simulation->setPaused(paused);
+}
+
 void Application::shutdown() {
     // ImGui cleanup
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
     
+    // stop stepping before anything the frame loop shares with it goes away
+    simulation.reset();
+    snapshot = nullptr;
     renderer.reset();
-    clothSystem.reset();
     camera.reset();
     
     // GLFW cleanup
@@ -429,22 +508,19 @@ void Application::keyCallback(GLFWwindow* window, int key, int /*scancode*/, int
                 app->wireframe = !app->wireframe;
                 break;
             case GLFW_KEY_1:
-                app->currentMode = SimulationMode::TEAR;
-                app->clothSystem->setMode(app->currentMode);
+                app->setMode(SimulationMode::TEAR);
                 break;
             case GLFW_KEY_2:
-                app->currentMode = SimulationMode::COLLISION;
-                app->clothSystem->setMode(app->currentMode);
+                app->setMode(SimulationMode::COLLISION);
                 break;
             case GLFW_KEY_3:
-                app->currentMode = SimulationMode::FLAG;
-                app->clothSystem->setMode(app->currentMode);
+                app->setMode(SimulationMode::FLAG);
                 break;
             case GLFW_KEY_R:
-                app->clothSystem->reset();
+                app->resetSimulation();
                 break;
             case GLFW_KEY_SPACE:
-                app->paused = !app->paused;
+                app->togglePause();
                 break;
             case GLFW_KEY_C:
                 app->camera->setOrbitalMode(!app->camera->isOrbitalMode());
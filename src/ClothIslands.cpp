@@ -0,0 +1,301 @@
+#include "ClothIslands.h"
+#include "ClothSystem.h"
+
+#include <algorithm>
+#include <limits>
+
+template <typename Visitor>
+void ClothIslands::forEachNeighbor(int particle, const SpringIncidence& incidence, const std::vector<Spring>& springs,
+                                   Visitor&& visit) {
+    for (int index : incidence.springsOf(particle)) {
+        const Spring& spring = springs[index];
+        visit(spring.particle1 == particle ? spring.particle2 : spring.particle1);
+    }
+}
+
+void ClothIslands::build(const ParticleStore& particles, const SpringIncidence& incidence,
+                         const std::vector<Spring>& springs) {
+    size_t count = particles.size();
+    islands.clear();
+    freeIds.clear();
+    labels.assign(count, -1);
+    slots.assign(count, -1);
+    stamps.assign(count, 0);
+    stamp = 0;
+
+    touched.clear();
+    anchors.clear();
+    changed.clear();
+    changedMarks.clear();
+    relabelMarks.clear();
+    relabelQueue.clear();
+    changesTaken = false;
+
+    // flood fill from every particle no earlier fill reached
+    for (size_t p = 0; p < count; ++p) {
+        int start = static_cast<int>(p);
+        if (!particles.isActive(p) || labels[start] >= 0) continue;
+
+        int island = allocate();
+        labels[start] = island;
+        frontA.assign(1, start);
+
+        for (size_t head = 0; head < frontA.size(); ++head) {
+            forEachNeighbor(frontA[head], incidence, springs, [&](int neighbor) {
+                if (labels[neighbor] >= 0) return;
+                labels[neighbor] = island;
+                frontA.push_back(neighbor);
+            });
+        }
+
+        islands[island].particles = frontA;
+        for (size_t i = 0; i < frontA.size(); ++i) {
+            slots[frontA[i]] = static_cast<int>(i);
+        }
+    }
+}
+
+void ClothIslands::removeParticle(int particle) {
+    int island = labels[particle];
+    if (island < 0) return;
+    takeChanges();
+
+    Island& owner = islands[island];
+    int slot = slots[particle];
+    int moved = owner.particles.back();
+    owner.particles[slot] = moved;
+    slots[moved] = slot;
+    owner.particles.pop_back();
+
+    labels[particle] = -1;
+    slots[particle] = -1;
+    markChanged(island);
+
+    if (owner.particles.empty()) {
+        owner = Island();
+        freeIds.push_back(island);
+    }
+}
+
+bool ClothIslands::matchesFloodFill(const ParticleStore& particles, const SpringIncidence& incidence,
+                                    const std::vector<Spring>& springs) const {
+    size_t count = particles.size();
+    if (labels.size() != count || !touched.empty()) return false;
+
+    // removed particles are in no island, the others where their island's list says
+    for (size_t p = 0; p < count; ++p) {
+        int island = labels[p];
+        if (!particles.isActive(p)) {
+            if (island >= 0) return false;
+            continue;
+        }
+        if (island < 0 || island >= capacity() || slots[p] < 0) return false;
+
+        const std::vector<int>& members = islands[island].particles;
+        if (slots[p] >= static_cast<int>(members.size()) || members[slots[p]] != static_cast<int>(p)) return false;
+    }
+
+    // every piece the fill finds has to be one island, and no island may turn up in two pieces
+    std::vector<unsigned char> reached(count, 0);
+    std::vector<unsigned char> claimed(islands.size(), 0);
+    std::vector<int> front;
+
+    for (size_t p = 0; p < count; ++p) {
+        int start = static_cast<int>(p);
+        if (!particles.isActive(p) || reached[start]) continue;
+
+        int island = labels[start];
+        if (claimed[island]) return false;
+        claimed[island] = 1;
+
+        reached[start] = 1;
+        front.assign(1, start);
+        size_t size = 0;
+        for (size_t head = 0; head < front.size(); ++head) {
+            if (labels[front[head]] != island) return false;
+            size++;
+            forEachNeighbor(front[head], incidence, springs, [&](int neighbor) {
+                if (reached[neighbor]) return;
+                reached[neighbor] = 1;
+                front.push_back(neighbor);
+            });
+        }
+        if (size != islands[island].particles.size()) return false;
+    }
+    return true;
+}
+
+const std::vector<int>& ClothIslands::update(const SpringIncidence& incidence, const std::vector<Spring>& springs) {
+    takeChanges();
+
+    // a piece that lost links is still whole if every touched particle still reaches the first one -
+    // any part cut off borders a broken link, so one of its particles was touched
+    // after a split the two sides are told apart by label and each gets its own anchor
+    for (int particle : touched) {
+        int island = labels[particle];
+        if (island < 0) continue;
+
+        int anchor = anchors[island];
+        if (anchor < 0) {
+            anchors[island] = particle;
+            continue;
+        }
+
+        checkLink(anchor, particle, incidence, springs);
+        anchors[labels[anchor]] = anchor;
+        if (labels[particle] != labels[anchor]) anchors[labels[particle]] = particle;
+    }
+    for (int particle : touched) {
+        int island = labels[particle];
+        if (island >= 0) anchors[island] = -1;
+    }
+    touched.clear();
+
+    // islands a search gave up on are labeled from scratch, once however many links they lost
+    for (int island : relabelQueue) {
+        relabelMarks[island] = 0;
+        relabel(island, incidence, springs);
+    }
+    relabelQueue.clear();
+
+    changesTaken = true;
+    return changed;
+}
+
+void ClothIslands::takeChanges() {
+    if (!changesTaken) return;
+
+    for (int island : changed) {
+        changedMarks[island] = 0;
+    }
+    changed.clear();
+    changesTaken = false;
+}
+
+int ClothIslands::allocate() {
+    if (!freeIds.empty()) {
+        int island = freeIds.back();
+        freeIds.pop_back();
+        return island;
+    }
+
+    islands.emplace_back();
+    anchors.push_back(-1);
+    changedMarks.push_back(0);
+    relabelMarks.push_back(0);
+    return static_cast<int>(islands.size()) - 1;
+}
+
+void ClothIslands::markChanged(int island) {
+    if (changedMarks[island]) return;
+    changedMarks[island] = 1;
+    changed.push_back(island);
+}
+
+unsigned int ClothIslands::nextStamp() {
+    // start over before wrapping around, stale stamps could match again
+    if (stamp == std::numeric_limits<unsigned int>::max()) {
+        std::fill(stamps.begin(), stamps.end(), 0u);
+        stamp = 0;
+    }
+    return ++stamp;
+}
+
+void ClothIslands::moveParticles(const std::vector<int>& part, int island) {
+    int from = labels[part.front()];
+    Island& source = islands[from];
+    Island& target = islands[island];
+
+    for (int particle : part) {
+        int slot = slots[particle];
+        int moved = source.particles.back();
+        source.particles[slot] = moved;
+        slots[moved] = slot;
+        source.particles.pop_back();
+
+        labels[particle] = island;
+        slots[particle] = static_cast<int>(target.particles.size());
+        target.particles.push_back(particle);
+    }
+
+    markChanged(from);
+    markChanged(island);
+}
+
+void ClothIslands::checkLink(int particle1, int particle2, const SpringIncidence& incidence,
+                             const std::vector<Spring>& springs) {
+    // the same particle, or waiting for a relabel anyway
+    int island = labels[particle1];
+    if (particle1 == particle2 || relabelMarks[island]) return;
+
+    unsigned int stampA = nextStamp();
+    unsigned int stampB = nextStamp();
+    stamps[particle1] = stampA;
+    stamps[particle2] = stampB;
+    frontA.assign(1, particle1);
+    frontB.assign(1, particle2);
+    size_t headA = 0, headB = 0;
+
+    while (true) {
+        // a search that runs dry without meeting the other has found a whole piece
+        if (headA == frontA.size()) {
+            moveParticles(frontA, allocate());
+            return;
+        }
+        if (headB == frontB.size()) {
+            moveParticles(frontB, allocate());
+            return;
+        }
+
+        if (frontA.size() + frontB.size() > SEARCH_BUDGET) {
+            relabelMarks[island] = 1;
+            relabelQueue.push_back(island);
+            return;
+        }
+
+        // grow the smaller search, so a split costs about twice the smaller piece
+        bool growA = frontA.size() <= frontB.size();
+        std::vector<int>& front = growA ? frontA : frontB;
+        size_t& head = growA ? headA : headB;
+        unsigned int own = growA ? stampA : stampB;
+        unsigned int other = growA ? stampB : stampA;
+
+        bool met = false;
+        forEachNeighbor(front[head++], incidence, springs, [&](int neighbor) {
+            if (stamps[neighbor] == other) {
+                met = true;
+            } else if (stamps[neighbor] != own) {
+                stamps[neighbor] = own;
+                front.push_back(neighbor);
+            }
+        });
+        if (met) return;
+    }
+}
+
+void ClothIslands::relabel(int island, const SpringIncidence& incidence, const std::vector<Spring>& springs) {
+    // the first piece keeps the id, moving the others edits the list, so walk a copy
+    std::vector<int> members = islands[island].particles;
+    unsigned int own = nextStamp();
+    bool first = true;
+
+    for (int start : members) {
+        if (stamps[start] == own) continue;
+
+        stamps[start] = own;
+        frontA.assign(1, start);
+        for (size_t head = 0; head < frontA.size(); ++head) {
+            forEachNeighbor(frontA[head], incidence, springs, [&](int neighbor) {
+                if (stamps[neighbor] == own) return;
+                stamps[neighbor] = own;
+                frontA.push_back(neighbor);
+            });
+        }
+
+        if (first) {
+            first = false;
+            continue;
+        }
+        moveParticles(frontA, allocate());
+    }
+}
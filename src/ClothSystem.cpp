@@ -1,218 +1,1053 @@
 #include "ClothSystem.h"
+#include "CounterRandom.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
 
 #include <random>
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <limits>
 
-Particle::Particle(const glm::vec3& pos) 
-    : position(pos), oldPosition(pos), velocity(0.0f), force(0.0f) {}
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// seconds since lapStart, restarting the lap
+double lap(Clock::time_point& lapStart) {
+    Clock::time_point now = Clock::now();
+    double seconds = std::chrono::duration<double>(now - lapStart).count();
+    lapStart = now;
+    return seconds;
+}
+
+// neighbor offsets of the springs a grid particle owns, in creation order
+// springs of one kind whose parity ((x or y) >> parityShift) & 1 matches never share a particle
+struct StencilKind {
+    int dx, dy;
+    bool parityOnX;
+    int parityShift;
+    float stiffness;
+    Spring::SpringType type;
+};
+
+const StencilKind STENCIL[] = {
+    {  1, 0, true,  0, 0.7f,  Spring::STRUCTURAL },   // right
+    {  0, 1, false, 0, 0.7f,  Spring::STRUCTURAL },   // below
+    {  1, 1, false, 0, 0.3f,  Spring::SHEAR },        // diagonal right
+    { -1, 1, false, 0, 0.3f,  Spring::SHEAR },        // diagonal left
+    {  2, 0, true,  1, 0.15f, Spring::BEND },         // far right
+    {  0, 2, false, 1, 0.15f, Spring::BEND }          // far below
+};
+
+// lift and drag on one triangle with face normal n (any length, zero for torn faces) moving
+// through the air with velocity u - with the unit normal m, drag = -|m.u| u opposes the motion and
+// lift = -(m.u) ((m x u) x u) / |u| = -(m.u) (u (m.u) / |u| - m |u|) acts across it
+// both flip along with n, so winding does not matter
+// the size of n is ignored on purpose - an overstretched face catching more wind would stretch further
+inline glm::vec3 triangleAerodynamics(const glm::vec3& n, const glm::vec3& u, float dragScale, float liftScale) {
+    float uu = glm::dot(u, u);
+    float invU = 1.0f / std::sqrt(std::max(uu, 1e-24f));
+    glm::vec3 m = n * (1.0f / std::sqrt(std::max(glm::dot(n, n), 1e-24f)));
+    float d = glm::dot(m, u);
+    
+    glm::vec3 drag = u * (-dragScale * std::abs(d));
+    glm::vec3 lift = (u * (d * invU) - m * (uu * invU)) * (-liftScale * d);
+    return drag + lift;
+}
+
+}
 
 Spring::Spring(int p1, int p2, float length, float k, SpringType t)
     : particle1(p1), particle2(p2), restLength(length), stiffness(k), type(t) {}
 
 CollisionSphere::CollisionSphere(const glm::vec3& c, float r) : center(c), radius(r) {}
 
-ClothSystem::ClothSystem(int width, int height, float w, float h)
-    : gridWidth(width), gridHeight(height), clothWidth(w), clothHeight(h) {
+ClothSystem::ClothSystem(int width, int height, float w, float h, const glm::vec3& origin)
+    : gridWidth(width), gridHeight(height), clothWidth(w), clothHeight(h), origin(origin),
+      windSeed(std::random_device()()), kernels(&ParticleKernels::get()), threadPool(&ThreadPool::shared()) {
     createClothGrid();
 }
 
 void ClothSystem::createClothGrid() {
-    particles.clear();
+    particles.resize(gridWidth * gridHeight);
     springs.clear();
     
     // create particles in a grid
     for (int y = 0; y < gridHeight; ++y) {
         for (int x = 0; x < gridWidth; ++x) {
-            float px = (x / float(gridWidth - 1)) * clothWidth - clothWidth * 0.5f;
-            float py = (y / float(gridHeight - 1)) * clothHeight;
-            float pz = 0.0f;
+            float px = (x / float(gridWidth - 1)) * clothWidth - clothWidth * 0.5f + origin.x;
+            float py = (y / float(gridHeight - 1)) * clothHeight + origin.y;
+            float pz = origin.z;
             
-            particles.emplace_back(glm::vec3(px, py, pz));
+            int index = particleIndex(x, y);
+            particles.setPosition(index, glm::vec3(px, py, pz));
+            particles.setPreviousPosition(index, glm::vec3(px, py, pz));
             
             // basic cloth behavior - pin top row
             if (y == gridHeight - 1) {
-                particles.back().pinned = true;
+                particles.setPinned(index, true);
             }
         }
     }
     
+    // one rest length per neighbor offset on the regular grid
+    float spacingX = clothWidth / float(gridWidth - 1);
+    float spacingY = clothHeight / float(gridHeight - 1);
+    for (int k = 0; k < STENCIL_KINDS; ++k) {
+        stencilRestLength[k] = glm::length(glm::vec3(STENCIL[k].dx * spacingX, STENCIL[k].dy * spacingY, 0.0f));
+    }
+    
     // create springs with different types and stiffness values
-    for (int y = 0; y < gridHeight; ++y) {
-        for (int x = 0; x < gridWidth; ++x) {
-            int current = y * gridWidth + x;
+    // structural to the right/below, shear along both diagonals, bend two particles apart
+    // emitted in particle order, so springs are sorted by their first particle in either layout
+    gridSprings.assign(particles.size() * STENCIL_KINDS, -1);
+    for (int current = 0; current < static_cast<int>(particles.size()); ++current) {
+        int x, y;
+        gridCoords(current, x, y);
+        
+        for (int k = 0; k < STENCIL_KINDS; ++k) {
+            const StencilKind& kind = STENCIL[k];
+            int nx = x + kind.dx;
+            int ny = y + kind.dy;
+            if (nx < 0 || nx >= gridWidth || ny >= gridHeight) continue;
             
-            // structural springs
-            if (x < gridWidth - 1) {
-                int right = y * gridWidth + (x + 1);
-                float length = glm::length(particles[right].position - particles[current].position);
-                springs.emplace_back(current, right, length, 0.7f, Spring::STRUCTURAL);  
+            gridSprings[current * STENCIL_KINDS + k] = static_cast<int>(springs.size());
+            springs.emplace_back(current, particleIndex(nx, ny), stencilRestLength[k], kind.stiffness, kind.type);
+            springs.back().compliance = typeCompliance[kind.type];
+        }
+    }
+    
+    // every tile starts untorn and is solved by the stencil kernel
+    tilesX = (gridWidth + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (gridHeight + TILE_SIZE - 1) / TILE_SIZE;
+    tileIntact.assign(tilesX * tilesY, 1);
+    tileTearing.assign(tilesX * tilesY, 0);
+    intactTilesDirty = true;
+    
+    // and awake
+    tileQuietSteps.assign(tilesX * tilesY, 0);
+    tileSleeping.assign(tilesX * tilesY, 0);
+    tileParked.assign(tilesX * tilesY, 0);
+    tileMarks.assign(tilesX * tilesY, 0);
+    tileBoundsMin.assign(tilesX * tilesY, glm::vec3(0.0f));
+    tileBoundsMax.assign(tilesX * tilesY, glm::vec3(0.0f));
+    bandDirty.assign(tilesY, 1);
+    sleepingTiles = 0;
+    restingSteps = 0;
+    renderVersion++;
+    
+    lambdas.assign(springs.size(), 0.0f);
+    deadSprings = 0;
+    meshDirty = true;
+    
+    normalX.assign(particles.paddedSize(), 0.0f);
+    normalY.assign(particles.paddedSize(), 0.0f);
+    normalZ.assign(particles.paddedSize(), 0.0f);
+    faceNormals.assign(13 * static_cast<size_t>(gridWidth - 1), 0.0f);
+    rowScratch.assign(layout == ParticleLayout::TILES ? 2 * 12 * static_cast<size_t>(gridWidth) : 0, 0.0f);
+    rowParticles.assign(layout == ParticleLayout::TILES ? 2 * static_cast<size_t>(gridWidth) : 0, -1);
+    normalsDirty = true;
+    
+    renderPrevX.assign(particles.paddedSize(), 0.0f);
+    renderPrevY.assign(particles.paddedSize(), 0.0f);
+    renderPrevZ.assign(particles.paddedSize(), 0.0f);
+    
+    windX.assign(particles.paddedSize(), 0.0f);
+    windY.assign(particles.paddedSize(), 0.0f);
+    windZ.assign(particles.paddedSize(), 0.0f);
+    aeroX.assign(particles.paddedSize(), 0.0f);
+    aeroY.assign(particles.paddedSize(), 0.0f);
+    aeroZ.assign(particles.paddedSize(), 0.0f);
+    aeroReady = false;
+    faceMass = particles.size() / (2.0f * (gridWidth - 1) * (gridHeight - 1));
+    
+    incidence.build(particles.size(), springs);
+    rebuildColoring();
+    
+    // one piece to begin with, solved by the tiles
+    islands.build(particles, incidence, springs);
+    standaloneIslands.clear();
+    pendingTornTiles.clear();
+    
+    spatialIndexDirty = true;
+    storeRenderState();
+    updateVertexData();
+}
+
+void ClothSystem::rebuildColoring() {
+    coloring.reset(particles.size(), springs.size());
+    
+    // only springs of torn tiles are solved explicitly, and not those of standalone islands
+    for (size_t i = 0; i < springs.size(); ++i) {
+        const Spring& spring = springs[i];
+        int tile = tileOf(spring.particle1);
+        if (spring.active && !tileIntact[tile] && !tileParked[tile] && !solvedAlone(spring.particle1)) {
+            coloring.add(static_cast<int>(i), spring.particle1, spring.particle2);
+        }
+    }
+}
+
+void ClothSystem::tearTile(int tile) {
+    if (!tileIntact[tile]) return;
+    
+    tileIntact[tile] = 0;
+    intactTilesDirty = true;
+    pendingTornTiles.push_back(tile);
+    
+    // hand the tile's remaining springs over to the explicit colored solve
+    if (!tileParked[tile]) colorTileSprings(tile, true);
+}
+
+void ClothSystem::colorTileSprings(int tile, bool solved) {
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, gridWidth);
+    int y1 = std::min(y0 + TILE_SIZE, gridHeight);
+    
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            for (int k = 0; k < STENCIL_KINDS; ++k) {
+                int index = gridSprings[particleIndex(x, y) * STENCIL_KINDS + k];
+                if (index < 0 || !springs[index].active || solvedAlone(springs[index].particle1)) continue;
+                
+                if (solved) coloring.add(index, springs[index].particle1, springs[index].particle2);
+                else        coloring.remove(index, springs[index].particle1, springs[index].particle2);
             }
-            if (y < gridHeight - 1) {
-                int below = (y + 1) * gridWidth + x;
-                float length = glm::length(particles[below].position - particles[current].position);
-                springs.emplace_back(current, below, length, 0.7f, Spring::STRUCTURAL);  
+        }
+    }
+}
+
+void ClothSystem::deactivateSpring(int index) {
+    Spring& spring = springs[index];
+    spring.active = false;
+    deadSprings++;
+    incidence.remove(index, spring.particle1, spring.particle2);
+    coloring.remove(index, spring.particle1, spring.particle2);
+    islands.linkBroken(spring.particle1, spring.particle2);
+    tearTile(tileOf(spring.particle1));
+    
+    // the tear lets go of whatever the spring held in place
+    wakeNeighborhood(tileOf(spring.particle1));
+    for (int particle : { spring.particle1, spring.particle2 }) {
+        int island = islands.islandOf(particle);
+        if (island >= 0) wakeIsland(island);
+    }
+}
+
+void ClothSystem::compactSprings() {
+    // survivors keep their order, so the grid and island lists only need their indices remapped
+    std::vector<int> remap(springs.size(), -1);
+    size_t live = 0;
+    for (size_t i = 0; i < springs.size(); ++i) {
+        if (!springs[i].active) continue;
+        
+        remap[i] = static_cast<int>(live);
+        springs[live++] = springs[i];
+    }
+    springs.erase(springs.begin() + live, springs.end());
+    lambdas.assign(springs.size(), 0.0f);
+    deadSprings = 0;
+    
+    for (int& index : gridSprings) {
+        if (index >= 0) index = remap[index];
+    }
+    for (int island : standaloneIslands) {
+        std::vector<int>& pieceSprings = islands[island].springs;
+        for (int& index : pieceSprings) {
+            index = remap[index];
+        }
+        pieceSprings.erase(std::remove(pieceSprings.begin(), pieceSprings.end(), -1), pieceSprings.end());
+    }
+    
+    incidence.build(particles.size(), springs);
+    rebuildColoring();
+}
+
+void ClothSystem::wakeTiles() {
+    size_t colliderCount = spheres.size() + (sharedColliders ? sharedColliders->size() : 0);
+    
+    // wind moves every particle, and a removed collider may have held anything up
+    if (!sleepEnabled || windStrength > 0.0f || colliderCount < lastColliders.size()) {
+        wakeAll();
+    }
+    
+    // a collider that moved wakes the sleeping tiles it can reach, a resting one does not
+    size_t c = 0;
+    auto wakeNear = [&](const CollisionSphere& sphere) {
+        float travelled = 0.0f;
+        if (c < lastColliders.size()) {
+            travelled = glm::length(sphere.center - lastColliders[c].center);
+            if (travelled == 0.0f && sphere.radius == lastColliders[c].radius) return;
+        }
+        
+        float reach = sphere.radius + travelled;
+        for (int tile = 0; tile < tilesX * tilesY && sleepingTiles > 0; ++tile) {
+            if (!tileSleeping[tile]) continue;
+            
+            glm::vec3 nearest = glm::clamp(sphere.center, tileBoundsMin[tile], tileBoundsMax[tile]);
+            glm::vec3 offset = nearest - sphere.center;
+            if (glm::dot(offset, offset) <= reach * reach) wakeNeighborhood(tile);
+        }
+        for (int island : standaloneIslands) {
+            const ClothIslands::Island& piece = islands[island];
+            if (!piece.sleeping) continue;
+            
+            glm::vec3 nearest = glm::clamp(sphere.center, piece.boundsMin, piece.boundsMax);
+            glm::vec3 offset = nearest - sphere.center;
+            if (glm::dot(offset, offset) <= reach * reach) wakeIsland(island);
+        }
+    };
+    
+    for (const auto& sphere : spheres) {
+        wakeNear(sphere);
+        c++;
+    }
+    if (sharedColliders) {
+        for (const auto& sphere : *sharedColliders) {
+            wakeNear(sphere);
+            c++;
+        }
+    }
+    
+    lastColliders.assign(spheres.begin(), spheres.end());
+    if (sharedColliders) {
+        lastColliders.insert(lastColliders.end(), sharedColliders->begin(), sharedColliders->end());
+    }
+}
+
+void ClothSystem::updateSleep() {
+    int tiles = tilesX * tilesY;
+    float sleepLimit = sleepThreshold * fixedTimeStep;
+    float wakeLimit = sleepLimit * WAKE_FACTOR;
+    float sleepLimitSq = sleepLimit * sleepLimit;
+    float wakeLimitSq = wakeLimit * wakeLimit;
+    
+    // largest displacement over the step per awake tile, from the state storeRenderState kept
+    // marks 1 past the sleep threshold, 2 past the wake threshold
+    threadPool->parallelFor(tiles, SLEEP_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            int tile = static_cast<int>(t);
+            tileMarks[tile] = 0;
+            if (tileSleeping[tile]) continue;
+            
+            int x0 = (tile % tilesX) * TILE_SIZE;
+            int y0 = (tile / tilesX) * TILE_SIZE;
+            int x1 = std::min(x0 + TILE_SIZE, gridWidth);
+            int y1 = std::min(y0 + TILE_SIZE, gridHeight);
+            
+            // a row of a tile is contiguous in either layout
+            float largest = 0.0f;
+            for (int y = y0; y < y1; ++y) {
+                int begin = particleIndex(x0, y);
+                for (int i = begin; i < begin + (x1 - x0); ++i) {
+                    float dx = particles.x[i] - renderPrevX[i];
+                    float dy = particles.y[i] - renderPrevY[i];
+                    float dz = particles.z[i] - renderPrevZ[i];
+                    largest = std::max(largest, dx * dx + dy * dy + dz * dz);
+                }
             }
             
-            // shear springs (diagonals)
-            if (x < gridWidth - 1 && y < gridHeight - 1) {
-                int diagRight = (y + 1) * gridWidth + (x + 1);
-                float length = glm::length(particles[diagRight].position - particles[current].position);
-                springs.emplace_back(current, diagRight, length, 0.3f, Spring::SHEAR);  
+            tileMarks[tile] = (largest > wakeLimitSq) ? 2 : (largest > sleepLimitSq) ? 1 : 0;
+            if (tileQuietSteps[tile] < SLEEP_WINDOW) tileQuietSteps[tile]++;
+        }
+    });
+    
+    // normals change in every tile row next to a tile that was awake for the step
+    bool anyAwake = sleepingTiles < tiles;
+    std::fill(bandDirty.begin(), bandDirty.end(), 0);
+    for (int tile = 0; tile < tiles; ++tile) {
+        if (tileSleeping[tile]) continue;
+        
+        int band = tile / tilesX;
+        for (int b = std::max(band - 1, 0); b <= std::min(band + 1, tilesY - 1); ++b) {
+            bandDirty[b] = 1;
+        }
+    }
+    
+    // motion restarts the window of the whole neighborhood, so a tile only sleeps once everything
+    // its springs reach has settled - sleeping neighbors are only woken by faster motion, they hold
+    // still against the small shift an awake tile makes as it settles next to them
+    for (int tile = 0; tile < tiles; ++tile) {
+        if (tileMarks[tile] == 2) {
+            wakeNeighborhood(tile);
+        } else if (tileMarks[tile] == 1) {
+            forEachNeighborTile(tile, [&](int neighbor) { tileQuietSteps[neighbor] = 0; });
+        }
+    }
+    
+    // a tile only goes to sleep along with its whole neighborhood, so a settled cloth falls asleep
+    // in one step rather than from the edges of a sleeping patch inwards
+    if (sleepEnabled && windStrength <= 0.0f) {
+        for (int tile = 0; tile < tiles; ++tile) {
+            tileMarks[tile] = !tileSleeping[tile] && neighborhoodSettled(tile);
+        }
+        for (int tile = 0; tile < tiles; ++tile) {
+            if (tileMarks[tile]) sleepTile(tile);
+        }
+    }
+    
+    updateIslandSleep();
+    
+    // the rendered state only stays put once a step after the last motion has gone by, see isAtRest
+    restingSteps = anyAwake ? 0 : restingSteps + 1;
+    if (restingSteps < 2) renderVersion++;
+}
+
+void ClothSystem::wakeTile(int tile) {
+    tileQuietSteps[tile] = 0;
+    if (!tileSleeping[tile]) return;
+    
+    tileSleeping[tile] = 0;
+    sleepingTiles--;
+    updateParking(tile);
+    
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, gridWidth);
+    int y1 = std::min(y0 + TILE_SIZE, gridHeight);
+    
+    // a piece asleep on the ground stays asleep
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            int index = particleIndex(x, y);
+            particles.setSleeping(index, islandAsleep(index));
+        }
+    }
+}
+
+void ClothSystem::wakeNeighborhood(int tile) {
+    forEachNeighborTile(tile, [&](int neighbor) { wakeTile(neighbor); });
+}
+
+void ClothSystem::wakeAll() {
+    for (int tile = 0; tile < tilesX * tilesY; ++tile) {
+        wakeTile(tile);
+    }
+    for (int island : standaloneIslands) {
+        wakeIsland(island);
+    }
+}
+
+void ClothSystem::sleepTile(int tile) {
+    tileSleeping[tile] = 1;
+    sleepingTiles++;
+    updateParking(tile);
+    
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, gridWidth);
+    int y1 = std::min(y0 + TILE_SIZE, gridHeight);
+    
+    // the residual velocity goes, and the bounds are what a moving collider has to reach to wake it
+    glm::vec3 lower(std::numeric_limits<float>::max());
+    glm::vec3 upper(-std::numeric_limits<float>::max());
+    
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            int index = particleIndex(x, y);
+            particles.setSleeping(index, true);
+            particles.setPreviousPosition(index, particles.position(index));
+            
+            if (!particles.isActive(index)) continue;
+            lower = glm::min(lower, particles.position(index));
+            upper = glm::max(upper, particles.position(index));
+        }
+    }
+    
+    tileBoundsMin[tile] = lower;
+    tileBoundsMax[tile] = upper;
+}
+
+void ClothSystem::updateParking(int tile) {
+    // a sleeping tile is still solved while a neighbor is awake to pull on its springs
+    forEachNeighborTile(tile, [&](int neighbor) {
+        unsigned char parked = neighborhoodAsleep(neighbor);
+        if (parked == tileParked[neighbor]) return;
+        
+        tileParked[neighbor] = parked;
+        intactTilesDirty = true;
+        if (!tileIntact[neighbor]) colorTileSprings(neighbor, !parked);
+    });
+}
+
+bool ClothSystem::neighborhoodSettled(int tile) const {
+    bool settled = true;
+    forEachNeighborTile(tile, [&](int neighbor) {
+        settled = settled && (tileSleeping[neighbor] || tileQuietSteps[neighbor] >= SLEEP_WINDOW);
+    });
+    return settled;
+}
+
+bool ClothSystem::neighborhoodAsleep(int tile) const {
+    bool asleep = true;
+    forEachNeighborTile(tile, [&](int neighbor) { asleep = asleep && tileSleeping[neighbor]; });
+    return asleep;
+}
+
+void ClothSystem::updateIslands() {
+    const std::vector<int>& changed = islands.update(incidence, springs);
+    if (changed.empty() && pendingTornTiles.empty()) return;
+    
+    // pieces that split or lost particles, and pieces reaching into a freshly torn tile
+    islandMarks.assign(islands.capacity(), 0);
+    for (int island : changed) {
+        islandMarks[island] = 1;
+    }
+    for (int tile : pendingTornTiles) {
+        int x0 = (tile % tilesX) * TILE_SIZE;
+        int y0 = (tile / tilesX) * TILE_SIZE;
+        int x1 = std::min(x0 + TILE_SIZE, gridWidth);
+        int y1 = std::min(y0 + TILE_SIZE, gridHeight);
+        
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                int island = islands.islandOf(particleIndex(x, y));
+                if (island >= 0) islandMarks[island] = 1;
             }
-            if (x > 0 && y < gridHeight - 1) {
-                int diagLeft = (y + 1) * gridWidth + (x - 1);
-                float length = glm::length(particles[diagLeft].position - particles[current].position);
-                springs.emplace_back(current, diagLeft, length, 0.3f, Spring::SHEAR);  
+        }
+    }
+    pendingTornTiles.clear();
+    
+    for (int island = 0; island < islands.capacity(); ++island) {
+        ClothIslands::Island& piece = islands[island];
+        if (!islandMarks[island] || piece.particles.empty()) continue;
+        
+        // tiles never heal and pieces only shrink, so once standalone a piece stays standalone
+        bool standalone = piece.particles.size() <= STANDALONE_LIMIT;
+        for (size_t i = 0; i < piece.particles.size() && standalone; ++i) {
+            standalone = !tileIntact[tileOf(piece.particles[i])];
+        }
+        if (!standalone) continue;
+        
+        // the springs each particle owns, in index order so the solve does not depend on how the piece was found
+        piece.springs.clear();
+        for (int particle : piece.particles) {
+            for (int index : incidence.springsOf(particle)) {
+                if (springs[index].particle1 == particle) piece.springs.push_back(index);
             }
+        }
+        std::sort(piece.springs.begin(), piece.springs.end());
+        
+        if (piece.standalone) continue;
+        piece.standalone = true;
+        for (int index : piece.springs) {
+            coloring.remove(index, springs[index].particle1, springs[index].particle2);
+        }
+    }
+    
+    standaloneIslands.clear();
+    for (int island = 0; island < islands.capacity(); ++island) {
+        if (islands[island].standalone && !islands[island].particles.empty()) standaloneIslands.push_back(island);
+    }
+}
+
+void ClothSystem::solveIslands() {
+    if (standaloneIslands.empty()) return;
+    
+    // pieces share no particles with each other or with the tiles, so each runs every
+    // iteration of the substep in one go on whichever thread picks it up
+    threadPool->parallelFor(standaloneIslands.size(), ISLAND_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            const ClothIslands::Island& piece = islands[standaloneIslands[k]];
+            if (piece.sleeping) continue;
             
-            // bend springs 
-            if (x < gridWidth - 2) {
-                int farRight = y * gridWidth + (x + 2);
-                float length = glm::length(particles[farRight].position - particles[current].position);
-                springs.emplace_back(current, farRight, length, 0.15f, Spring::BEND);  
+            for (int i = 0; i < solverIterations; ++i) {
+                for (int index : piece.springs) {
+                    if (solveSpring(springs[index])) {
+                        std::lock_guard<std::mutex> lock(tornMutex);
+                        tornSprings.push_back(index);
+                    }
+                }
             }
-            if (y < gridHeight - 2) {
-                int farBelow = (y + 2) * gridWidth + x;
-                float length = glm::length(particles[farBelow].position - particles[current].position);
-                springs.emplace_back(current, farBelow, length, 0.15f, Spring::BEND);  
+        }
+    });
+    
+    releaseTornSprings();
+}
+
+void ClothSystem::updateIslandSleep() {
+    if (standaloneIslands.empty()) return;
+    
+    float sleepLimit = sleepThreshold * fixedTimeStep;
+    float sleepLimitSq = sleepLimit * sleepLimit;
+    
+    threadPool->parallelFor(standaloneIslands.size(), ISLAND_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            ClothIslands::Island& piece = islands[standaloneIslands[k]];
+            if (piece.sleeping) continue;
+            
+            float largest = 0.0f;
+            float lowest = std::numeric_limits<float>::max();
+            for (int i : piece.particles) {
+                float dx = particles.x[i] - renderPrevX[i];
+                float dy = particles.y[i] - renderPrevY[i];
+                float dz = particles.z[i] - renderPrevZ[i];
+                largest = std::max(largest, dx * dx + dy * dy + dz * dz);
+                lowest = std::min(lowest, particles.y[i]);
             }
+            
+            piece.quietSteps = (largest > sleepLimitSq) ? 0 : std::min(piece.quietSteps + 1, SLEEP_WINDOW);
+            piece.grounded = lowest <= GROUND_HEIGHT + GROUND_CONTACT;
         }
+    });
+    
+    // nothing joins a piece to the rest of the cloth, so it sleeps on its own once it lies still on the ground
+    if (!sleepEnabled || windStrength > 0.0f) return;
+    for (int island : standaloneIslands) {
+        const ClothIslands::Island& piece = islands[island];
+        if (!piece.sleeping && piece.grounded && piece.quietSteps >= SLEEP_WINDOW) sleepIsland(island);
     }
+}
+
+void ClothSystem::wakeIsland(int island) {
+    ClothIslands::Island& piece = islands[island];
+    piece.quietSteps = 0;
+    if (!piece.sleeping) return;
     
-    updateVertexData();
+    // particles of a sleeping tile stay asleep with it
+    piece.sleeping = false;
+    for (int i : piece.particles) {
+        particles.setSleeping(i, tileSleeping[tileOf(i)] != 0);
+    }
+}
+
+void ClothSystem::sleepIsland(int island) {
+    ClothIslands::Island& piece = islands[island];
+    piece.sleeping = true;
+    
+    glm::vec3 lower(std::numeric_limits<float>::max());
+    glm::vec3 upper(-std::numeric_limits<float>::max());
+    
+    for (int i : piece.particles) {
+        particles.setSleeping(i, true);
+        particles.setPreviousPosition(i, particles.position(i));
+        lower = glm::min(lower, particles.position(i));
+        upper = glm::max(upper, particles.position(i));
+    }
+    
+    piece.boundsMin = lower;
+    piece.boundsMax = upper;
+}
+
+int ClothSystem::getSleepingIslandCount() const {
+    int count = 0;
+    for (int island : standaloneIslands) {
+        count += islands[island].sleeping ? 1 : 0;
+    }
+    return count;
 }
 
 void ClothSystem::update(float deltaTime) {
-    elapsedTime += deltaTime;                       
-    while (elapsedTime >= fixedTimeStep) {
+    Clock::time_point lapStart = Clock::now();
+    
+    // bounded - steps stop at the scheduler's step cap or wall-clock budget
+    scheduler.beginFrame(deltaTime);
+    while (scheduler.nextStep()) {
+        storeRenderState();
+        
+        wakeTiles();
+        updateIslands();
+        if (islandChecks && !islands.matchesFloodFill(particles, incidence, springs)) islandMismatches++;
+        
+        // torn springs go once they are a quarter of the list, between steps nothing holds a spring index
+        if (deadSprings * 4 > springs.size()) compactSprings();
+        coloring.sortStaleBatches();
+        timings.bookkeeping += lap(lapStart);
+        
         applyForces();
-        integrateVerlet(fixedTimeStep);
+        timings.forces += lap(lapStart);
         
-        // stabilize with multiple constraint satisfactions
-        for (int i = 0; i < 3; ++i) {
-            satisfyConstraints();
+        // many small substeps with few iterations converge faster than more iterations per step
+        substepDeltaTime = fixedTimeStep / substeps;
+        for (int step = 0; step < substeps; ++step) {
+            integrateVerlet(substepDeltaTime);
+            timings.integrate += lap(lapStart);
+            
+            if (solverMode == SolverMode::XPBD) {
+                std::fill(lambdas.begin(), lambdas.end(), 0.0f);
+            }
+            
+            // stabilize with multiple constraint satisfactions
+            solveConstraints();
+            solveIslands();
+            timings.constraints += lap(lapStart);
+            
+            handleCollisions();
+            timings.collisions += lap(lapStart);
         }
         
-        handleCollisions();
-        elapsedTime -= fixedTimeStep;
+        // scene animation advances with simulated time, not with the frame
+        updateObjectMovement(fixedTimeStep);
+        updateWindVariation(fixedTimeStep);
+        
+        windStep++;
+        
+        updateSleep();
+        timings.bookkeeping += lap(lapStart);
+        
+        // normals of the finished step, and from the same face normals the wind forces for the next
+        bool aerodynamics = windStrength > 0.0f;
+        computeNormals(aerodynamics);
+        aeroReady = aerodynamics;
+        timings.normals += lap(lapStart);
+        
+        timings.steps++;
     }
     
-    updateObjectMovement(deltaTime);
-    updateWindVariation(deltaTime);
+    scheduler.endFrame();
+    timings.skippedSteps += scheduler.getLastSkipped();
     
+    spatialIndexDirty = true;
+    
+    lap(lapStart);
     updateVertexData();
+    timings.vertexData += lap(lapStart);
+    timings.frames++;
 }
 
 void ClothSystem::applyForces() {
-    for (auto& particle : particles) {
-        if (!particle.active || particle.pinned) continue;
-        
-        particle.force = glm::vec3(0.0f);               // reset forces
-        particle.force.y += gravity * particle.mass;    // gravity
-        
-        if (windStrength > 0.0f) {                      // wind force
-            applyWindForce(particle);
-        }
+    // reset forces + gravity
+    kernels->applyGravity(particles, gravity);
+    
+    // lift and drag the last step's normals pass worked out
+    if (windStrength > 0.0f && aeroReady) {
+        particles.forEachFree([&](size_t i) {
+            particles.forceX[i] += aeroX[i];
+            particles.forceY[i] += aeroY[i];
+            particles.forceZ[i] += aeroZ[i];
+        });
     }
 }
 
-void ClothSystem::applyWindForce(Particle& particle) {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_real_distribution<float> turbulence(-1.0f, 1.0f);
-    
-    // base wind force
-    glm::vec3 wind = windDirection * windStrength;
+void ClothSystem::sampleWind() {
+    windField.setBase(windDirection, windStrength);
     
-    // add turbulence for more wind realism
-    glm::vec3 turbulenceVec(
-        turbulence(gen) * 0.3f,
-        turbulence(gen) * 0.2f,
-        turbulence(gen) * 0.3f
-    );
-    wind += turbulenceVec * windStrength;
+    // a little per-particle turbulence adds flutter on top of the coherent gusts
+    WindTurbulence turbulence;
+    turbulence.amplitudeX = 0.1f * windStrength;
+    turbulence.amplitudeY = 0.05f * windStrength;
+    turbulence.amplitudeZ = 0.1f * windStrength;
     
-    // wind resistance based on velocity
-    glm::vec3 relativeVelocity = wind - particle.velocity;
-    float velocityMagnitude = glm::length(relativeVelocity);
+    // one stream per axis, the particle index is the counter - any split gives the same bits
+    turbulence.keyX = CounterRandom::key(windSeed, windStep, 0);
+    turbulence.keyY = CounterRandom::key(windSeed, windStep, 1);
+    turbulence.keyZ = CounterRandom::key(windSeed, windStep, 2);
     
-    if (velocityMagnitude > 0.0f) {
-        glm::vec3 normalizedVelocity = relativeVelocity / velocityMagnitude;
-        float dragCoefficient = 0.1f;
-        glm::vec3 windForce = normalizedVelocity * velocityMagnitude * velocityMagnitude * dragCoefficient;
-        particle.force += windForce * particle.mass;
-    }
+    threadPool->parallelFor(particles.size(), WIND_GRAIN_SIZE, [&](size_t begin, size_t end) {
+        windField.sample(&particles.x[begin], &particles.y[begin], &particles.z[begin],
+                         &windX[begin], &windY[begin], &windZ[begin], end - begin);
+        kernels->addTurbulence(turbulence, windX.data(), windY.data(), windZ.data(), begin, end);
+    });
 }
 
 void ClothSystem::integrateVerlet(float deltaTime) {
-    for (auto& particle : particles) {
-        if (particle.pinned || !particle.active) continue;
-        
-        glm::vec3 acceleration = particle.force / particle.mass;
-        glm::vec3 newPosition = particle.position + 
-                               (particle.position - particle.oldPosition) * damping + 
-                               acceleration * deltaTime * deltaTime;
-        
-        particle.oldPosition = particle.position;
-        particle.position = newPosition;
+    // damping is defined per reference step, rescale it to whatever step or substep this is
+    float stepDamping = (deltaTime == DAMPING_TIME_STEP) ? damping : std::pow(damping, deltaTime / DAMPING_TIME_STEP);
+    kernels->integrateVerlet(particles, stepDamping, deltaTime);
+}
+
+void ClothSystem::solveConstraints() {
+    // the grid fits the cache as it is, or blocking is off - every iteration passes over all of it
+    if (!cacheBlocking || particles.size() < BLOCKING_MIN_PARTICLES) {
+        for (int i = 0; i < solverIterations; ++i) {
+            satisfyConstraints();
+        }
+        return;
+    }
+    
+    updateIntactTiles();
+    solveStencilBlocks();
+    releaseTornSprings();
+    
+    // the torn tiles, tiles that tore just now included, get their iterations after the blocks
+    for (int i = 0; i < solverIterations; ++i) {
+        solveColoredBatches();
+        releaseTornSprings();
     }
 }
 
 void ClothSystem::satisfyConstraints() {
-    for (auto& spring : springs) {
-        if (!spring.active) continue;
-        
-        Particle& p1 = particles[spring.particle1];
-        Particle& p2 = particles[spring.particle2];
+    updateIntactTiles();
+    solveStencilPasses();
+    solveColoredBatches();
+    releaseTornSprings();
+}
+
+void ClothSystem::updateIntactTiles() {
+    if (!intactTilesDirty) return;
+    
+    intactTiles.clear();
+    for (int tile = 0; tile < tilesX * tilesY; ++tile) {
+        if (tileIntact[tile] && !tileParked[tile]) intactTiles.push_back(tile);
+    }
+    
+    // the same tiles grouped by block for solveStencilBlocks, empty blocks left out
+    int blocksX = (tilesX + BLOCK_TILES - 1) / BLOCK_TILES;
+    int blocksY = (tilesY + BLOCK_TILES - 1) / BLOCK_TILES;
+    blockTiles.clear();
+    blockOffsets.clear();
+    
+    for (int parity = 0; parity < 4; ++parity) {
+        parityOffsets[parity] = blockOffsets.size();
         
-        if (!p1.active || !p2.active) continue;
+        for (int by = parity >> 1; by < blocksY; by += 2) {
+            for (int bx = parity & 1; bx < blocksX; bx += 2) {
+                size_t first = blockTiles.size();
+                
+                for (int ty = by * BLOCK_TILES; ty < std::min((by + 1) * BLOCK_TILES, tilesY); ++ty) {
+                    for (int tx = bx * BLOCK_TILES; tx < std::min((bx + 1) * BLOCK_TILES, tilesX); ++tx) {
+                        int tile = ty * tilesX + tx;
+                        if (tileIntact[tile] && !tileParked[tile]) blockTiles.push_back(tile);
+                    }
+                }
+                if (blockTiles.size() > first) blockOffsets.push_back(first);
+            }
+        }
+    }
+    parityOffsets[4] = blockOffsets.size();
+    blockOffsets.push_back(blockTiles.size());
+    
+    intactTilesDirty = false;
+}
+
+void ClothSystem::solveStencilPasses() {
+    // untorn tiles - neighbors come from the grid offsets, one pass per (kind, parity) so
+    // the springs of a pass share no particles and tiles can be solved in parallel
+    for (int k = 0; k < STENCIL_KINDS; ++k) {
+        for (int parity = 0; parity < 2; ++parity) {
+            threadPool->parallelFor(intactTiles.size(), STENCIL_GRAIN_SIZE, [&](size_t begin, size_t end) {
+                for (size_t t = begin; t < end; ++t) {
+                    solveStencilTile(intactTiles[t], k, parity);
+                }
+            });
+        }
+    }
+}
+
+void ClothSystem::solveStencilBlocks() {
+    // one task per block, the same pass order as solveStencilPasses inside it
+    for (int parity = 0; parity < 4; ++parity) {
+        size_t firstBlock = parityOffsets[parity];
         
-        glm::vec3 delta = p2.position - p1.position;
-        float distance = glm::length(delta);
+        threadPool->parallelFor(parityOffsets[parity + 1] - firstBlock, 1, [&](size_t begin, size_t end) {
+            for (size_t b = firstBlock + begin; b < firstBlock + end; ++b) {
+                for (int i = 0; i < solverIterations; ++i) {
+                    for (int k = 0; k < STENCIL_KINDS; ++k) {
+                        for (int tileParity = 0; tileParity < 2; ++tileParity) {
+                            for (size_t t = blockOffsets[b]; t < blockOffsets[b + 1]; ++t) {
+                                // a torn spring would be pulled back together - its tile goes to the
+                                // colored solve once the blocks are done and sits out until then
+                                int tile = blockTiles[t];
+                                if (!tileTearing[tile]) solveStencilTile(tile, k, tileParity);
+                            }
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
+
+void ClothSystem::solveColoredBatches() {
+    // torn tiles - springs of one color share no particles, so each batch is solved in
+    // parallel and the batches run one after another (gauss-seidel across colors)
+    for (const auto& batch : coloring.getBatches()) {
+        threadPool->parallelFor(batch.size(), SOLVER_GRAIN_SIZE, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                if (solveSpring(springs[batch[k]])) {
+                    std::lock_guard<std::mutex> lock(tornMutex);
+                    tornSprings.push_back(batch[k]);
+                }
+            }
+        });
+    }
+}
+
+void ClothSystem::releaseTornSprings() {
+    // tiles and batches can only be edited once no solve is in flight
+    // threads push in whatever order they reach a tear, and the coloring depends on the order of
+    // adds - sorted, a run gives the same bits at any thread count
+    std::sort(tornSprings.begin(), tornSprings.end());
+    for (int index : tornSprings) {
+        tileTearing[tileOf(springs[index].particle1)] = 0;
+        deactivateSpring(index);
+    }
+    tornSprings.clear();
+}
+
+void ClothSystem::solveStencilTile(int tile, int kindIndex, int parity) {
+    const StencilKind& kind = STENCIL[kindIndex];
+    float restLength = stencilRestLength[kindIndex];
+    float tearLength = restLength * tearThreshold;
+    
+    // XPBD - multipliers start at zero each substep, so a single iteration never has to load them
+    bool xpbd = solverMode == SolverMode::XPBD;
+    bool accumulateLambda = xpbd && solverIterations > 1;
+    float alpha = typeCompliance[kind.type] / (substepDeltaTime * substepDeltaTime);
+    
+    int tileX0 = (tile % tilesX) * TILE_SIZE;
+    int tileX1 = std::min(tileX0 + TILE_SIZE, gridWidth);
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int y1 = std::min(y0 + TILE_SIZE, gridHeight);
+    
+    // clip the tile so (x + dx, y + dy) stays on the grid
+    int x0 = std::max(tileX0, -kind.dx);
+    int x1 = std::min(tileX1, gridWidth - std::max(kind.dx, 0));
+    y1 = std::min(y1, gridHeight - kind.dy);
+    
+    for (int y = y0; y < y1; ++y) {
+        if (!kind.parityOnX && ((y >> kind.parityShift) & 1) != parity) continue;
         
-        if (distance < 1e-6f) continue; 
+        // the tile's columns are contiguous in its rows and in the row below it in either layout,
+        // only a neighbor across the left or right border needs the full lookup
+        int row1 = particleIndex(tileX0, y) - tileX0;
+        int row2 = particleIndex(tileX0, y + kind.dy) - tileX0;
         
-        if (checkTearing(spring)) {
-            spring.active = false;
-            continue;
+        for (int x = x0; x < x1; ++x) {
+            if (kind.parityOnX && ((x >> kind.parityShift) & 1) != parity) continue;
+            
+            // an intact tile only has active springs, so both particles are active
+            int nx = x + kind.dx;
+            int i1 = row1 + x;
+            int i2 = (nx >= tileX0 && nx < tileX1) ? row2 + nx : particleIndex(nx, y + kind.dy);
+
+            float dx = particles.x[i2] - particles.x[i1];
+            float dy = particles.y[i2] - particles.y[i1];
+            float dz = particles.z[i2] - particles.z[i1];
+            float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+            
+            if (distance < 1e-6f) continue;
+            
+            if (distance > tearLength) {
+                int index = gridSprings[i1 * STENCIL_KINDS + kindIndex];
+                springs[index].active = false;
+                tileTearing[tile] = 1;
+                
+                std::lock_guard<std::mutex> lock(tornMutex);
+                tornSprings.push_back(index);
+                continue;
+            }
+            
+            // pinned and sleeping particles have infinite mass, a spring between two of them has nothing to do
+            bool fixed1 = !particles.isFree(i1);
+            bool fixed2 = !particles.isFree(i2);
+            if (fixed1 && fixed2) continue;
+            
+            float w1 = particles.invMass[i1];
+            float w2 = particles.invMass[i2];
+            float ratio1, ratio2, scale;
+            
+            if (xpbd) {
+                w1 = fixed1 ? 0.0f : w1;
+                w2 = fixed2 ? 0.0f : w2;
+                if (w1 + w2 + alpha <= 0.0f) continue;
+                
+                float* lambda = accumulateLambda ? &lambdas[gridSprings[i1 * STENCIL_KINDS + kindIndex]] : nullptr;
+                float previous = lambda ? *lambda : 0.0f;
+                float deltaLambda = (restLength - distance - alpha * previous) / (w1 + w2 + alpha);
+                if (lambda) *lambda = previous + deltaLambda;
+                
+                scale = deltaLambda / distance;
+                ratio1 = w1;
+                ratio2 = w2;
+            } else {
+                scale = (restLength - distance) / distance * kind.stiffness;
+                ratio1 = w1 / (w1 + w2);
+                ratio2 = w2 / (w1 + w2);
+            }
+            
+            if (!fixed1) {
+                particles.x[i1] -= dx * scale * ratio1;
+                particles.y[i1] -= dy * scale * ratio1;
+                particles.z[i1] -= dz * scale * ratio1;
+            }
+            if (!fixed2) {
+                particles.x[i2] += dx * scale * ratio2;
+                particles.y[i2] += dy * scale * ratio2;
+                particles.z[i2] += dz * scale * ratio2;
+            }
         }
+    }
+}
+
+bool ClothSystem::solveSpring(Spring& spring) {
+    if (!spring.active) return false;
+    
+    int i1 = spring.particle1;
+    int i2 = spring.particle2;
+    
+    if (!particles.isActive(i1) || !particles.isActive(i2)) return false;
+    
+    glm::vec3 delta = particles.position(i2) - particles.position(i1);
+    float distance = glm::length(delta);
+    
+    if (distance < 1e-6f) return false; 
+    
+    // the length is already at hand, the tear test does not measure it again
+    if (checkTearing(spring, distance)) {
+        spring.active = false;
+        return true;
+    }
+    
+    // pinned and sleeping particles have infinite mass
+    bool fixed1 = !particles.isFree(i1);
+    bool fixed2 = !particles.isFree(i2);
+    if (fixed1 && fixed2) return false;
+    
+    float w1 = particles.invMass[i1];
+    float w2 = particles.invMass[i2];
+    glm::vec3 translate;
+    float ratio1, ratio2;
+    
+    if (solverMode == SolverMode::XPBD) {
+        // compliance scaled by the substep so stiffness does not depend on dt or iteration count
+        w1 = fixed1 ? 0.0f : w1;
+        w2 = fixed2 ? 0.0f : w2;
+        float alpha = spring.compliance / (substepDeltaTime * substepDeltaTime);
+        if (w1 + w2 + alpha <= 0.0f) return false;
+        
+        float& lambda = lambdas[&spring - springs.data()];
+        float deltaLambda = (spring.restLength - distance - alpha * lambda) / (w1 + w2 + alpha);
+        lambda += deltaLambda;
         
+        translate = delta * (deltaLambda / distance);
+        ratio1 = w1;
+        ratio2 = w2;
+    } else {
         float difference = (spring.restLength - distance) / distance;
-        glm::vec3 translate = delta * difference * spring.stiffness;
+        translate = delta * difference * spring.stiffness;
         
         // apply correction based on mass ratio
-        float totalMass = p1.mass + p2.mass;
-        float ratio1 = p2.mass / totalMass;
-        float ratio2 = p1.mass / totalMass;
-        
-        if (!p1.pinned) p1.position -= translate * ratio1;
-        if (!p2.pinned) p2.position += translate * ratio2;
+        ratio1 = w1 / (w1 + w2);
+        ratio2 = w2 / (w1 + w2);
     }
+    
+    if (!fixed1) particles.setPosition(i1, particles.position(i1) - translate * ratio1);
+    if (!fixed2) particles.setPosition(i2, particles.position(i2) + translate * ratio2);
+    
+    return false;
 }
 
-bool ClothSystem::checkTearing(const Spring& spring) {
-    const Particle& p1 = particles[spring.particle1];
-    const Particle& p2 = particles[spring.particle2];
-    
-    float distance = glm::length(p2.position - p1.position);
+bool ClothSystem::checkTearing(const Spring& spring, float distance) const {
     return distance > spring.restLength * tearThreshold;
 }
 
 void ClothSystem::handleCollisions() {
-    for (auto& particle : particles) {
-        if (!particle.active) continue;
+    // sleeping particles stay where they came to rest, a collider that moves wakes them first
+    particles.forEachAwake([&](size_t i) {
+        glm::vec3 position = particles.position(i);
+        glm::vec3 oldPosition = particles.previousPosition(i);
         
-        // sphere collisions
-        for (const auto& sphere : spheres) {
-            glm::vec3 diff = particle.position - sphere.center;
+        // sphere collisions, the cloth's own and those shared across a world
+        auto collide = [&](const CollisionSphere& sphere) {
+            glm::vec3 diff = position - sphere.center;
             float distance = glm::length(diff);
             
             if (distance < sphere.radius) {
                 glm::vec3 normal = (distance > 1e-6f) ? diff / distance : glm::vec3(0.0f, 1.0f, 0.0f);
-                particle.position = sphere.center + normal * sphere.radius;
-                glm::vec3 velocity = particle.position - particle.oldPosition;
+                position = sphere.center + normal * sphere.radius;
+                glm::vec3 velocity = position - oldPosition;
 
                 float vn = glm::dot(velocity, normal);
                 glm::vec3 vNormal = vn * normal;
@@ -222,123 +1057,427 @@ void ClothSystem::handleCollisions() {
                 float friction = 0.9f;      
                 glm::vec3 newVelocity = vTangent * friction - vNormal * bounce;
 
-                particle.oldPosition = particle.position - newVelocity;
+                oldPosition = position - newVelocity;
             }
+        };
+        
+        for (const auto& sphere : spheres) collide(sphere);
+        if (sharedColliders) {
+            for (const auto& sphere : *sharedColliders) collide(sphere);
         }
         
         // bounce for ground collision w/ ground plane
-        if (particle.position.y < -5.0f) {
-            particle.position.y = -5.0f;
-            glm::vec3 velocity = particle.position - particle.oldPosition;
-            particle.oldPosition = particle.position - velocity * 0.4f; 
+        if (position.y < GROUND_HEIGHT) {
+            position.y = GROUND_HEIGHT;
+            glm::vec3 velocity = position - oldPosition;
+            oldPosition = position - velocity * 0.4f; 
         }
-    }
+        
+        particles.setPosition(i, position);
+        particles.setPreviousPosition(i, oldPosition);
+    });
 }
 
 void ClothSystem::updateVertexData() {
-    vertices.clear();
-    indices.clear();
+    // the remap is compacted once a quarter of the vertices belong to removed particles
+    if (meshDirty || deadVertices * 4 > vertexParticles.size()) {
+        rebuildMesh();
+    }
     
-    // map from grid pos to vertex index for active particles
-    std::vector<int> gridToVertex(gridWidth * gridHeight, -1);
-    int vertexCount = 0;
+    // normally already done by the last step
+    if (normalsDirty) computeNormals();
+}
+
+void ClothSystem::storeRenderState() {
+    std::copy(particles.x.begin(), particles.x.end(), renderPrevX.begin());
+    std::copy(particles.y.begin(), particles.y.end(), renderPrevY.begin());
+    std::copy(particles.z.begin(), particles.z.end(), renderPrevZ.begin());
+    
+    renderPrevSphereCenters.clear();
+    for (const auto& sphere : spheres) {
+        renderPrevSphereCenters.push_back(sphere.center);
+    }
+}
+
+float ClothSystem::getInterpolationAlpha() const {
+    return std::min(scheduler.getLeftoverTime() / fixedTimeStep, 1.0f);
+}
+
+void ClothSystem::writePreviousPositions(float* positions) const {
+    for (size_t v = 0; v < vertexParticles.size(); ++v) {
+        int index = vertexParticles[v];
+        
+        float* position = &positions[v * 3];
+        position[0] = renderPrevX[index];
+        position[1] = renderPrevY[index];
+        position[2] = renderPrevZ[index];
+    }
+}
+
+void ClothSystem::writeVertices(float* positions, float* normals, float alpha) const {
+    // usually mapped GPU memory - written strictly in order and never read back
+    for (size_t v = 0; v < vertexParticles.size(); ++v) {
+        int index = vertexParticles[v];
+        
+        // position, normals are not blended and always belong to the current step
+        float* position = &positions[v * 3];
+        position[0] = renderPrevX[index] + (particles.x[index] - renderPrevX[index]) * alpha;
+        position[1] = renderPrevY[index] + (particles.y[index] - renderPrevY[index]) * alpha;
+        position[2] = renderPrevZ[index] + (particles.z[index] - renderPrevZ[index]) * alpha;
+        
+        // smooth normal, removed particles have none and are not referenced by any triangle
+        float* normal = &normals[v * 3];
+        float nx = normalX[index];
+        float ny = normalY[index];
+        float nz = normalZ[index];
+        float lengthSq = nx * nx + ny * ny + nz * nz;
+        
+        if (lengthSq > 1e-20f) {
+            float invLength = 1.0f / std::sqrt(lengthSq);
+            normal[0] = nx * invLength;
+            normal[1] = ny * invLength;
+            normal[2] = nz * invLength;
+        } else {
+            normal[0] = 0.0f;
+            normal[1] = 0.0f;
+            normal[2] = 1.0f;
+        }
+    }
+}
+
+void ClothSystem::rebuildMesh() {
+    vertexParticles.clear();
+    particleVertex.assign(particles.size(), -1);
     
-    // vertices with normals and texture coords
+    // map from grid pos to vertex index for active particles
     for (int y = 0; y < gridHeight; ++y) {
         for (int x = 0; x < gridWidth; ++x) {
-            int gridIndex = y * gridWidth + x;
-            const Particle& p = particles[gridIndex];
+            int gridIndex = particleIndex(x, y);
+            if (!particles.isActive(gridIndex)) continue;
             
-            if (!p.active) continue;
+            particleVertex[gridIndex] = static_cast<int>(vertexParticles.size());
+            vertexParticles.push_back(gridIndex);
+        }
+    }
+    
+    // texture coords never change, positions and normals are written per frame
+    texCoords.resize(vertexParticles.size() * 2);
+    for (size_t v = 0; v < vertexParticles.size(); ++v) {
+        int index = vertexParticles[v];
+        int x, y;
+        gridCoords(index, x, y);
+        texCoords[v * 2] = x / float(gridWidth - 1);
+        texCoords[v * 2 + 1] = y / float(gridHeight - 1);
+    }
+    
+    // triangle indices, 6 per quad with every corner active
+    indices.clear();
+    quadSlot.assign((gridWidth - 1) * (gridHeight - 1), -1);
+    slotQuad.clear();
+    
+    for (int y = 0; y < gridHeight - 1; ++y) {
+        for (int x = 0; x < gridWidth - 1; ++x) {
+            int topLeft = particleVertex[particleIndex(x, y)];
+            int topRight = particleVertex[particleIndex(x + 1, y)];
+            int bottomLeft = particleVertex[particleIndex(x, y + 1)];
+            int bottomRight = particleVertex[particleIndex(x + 1, y + 1)];
             
-            gridToVertex[gridIndex] = vertexCount++;
+            if (topLeft == -1 || topRight == -1 || bottomLeft == -1 || bottomRight == -1) continue;
             
-            // position
-            vertices.push_back(p.position.x);
-            vertices.push_back(p.position.y);
-            vertices.push_back(p.position.z);
+            int quad = y * (gridWidth - 1) + x;
+            quadSlot[quad] = static_cast<int>(slotQuad.size());
+            slotQuad.push_back(quad);
             
-            // smooth normal
-            glm::vec3 normal = calculateNormal(x, y);
-            vertices.push_back(normal.x);
-            vertices.push_back(normal.y);
-            vertices.push_back(normal.z);
+            // first triangle
+            indices.push_back(topLeft);
+            indices.push_back(bottomLeft);
+            indices.push_back(topRight);
             
-            // texture coords
-            vertices.push_back(x / float(gridWidth - 1));
-            vertices.push_back(y / float(gridHeight - 1));
+            // second triangle
+            indices.push_back(topRight);
+            indices.push_back(bottomLeft);
+            indices.push_back(bottomRight);
         }
     }
     
-    // triangle indices
-    for (int y = 0; y < gridHeight - 1; ++y) {
-        for (int x = 0; x < gridWidth - 1; ++x) {
-            int topLeft = y * gridWidth + x;
-            int topRight = y * gridWidth + (x + 1);
-            int bottomLeft = (y + 1) * gridWidth + x;
-            int bottomRight = (y + 1) * gridWidth + (x + 1);
-            
-            // check if all particles in quad are active + have valid vertex indices
-            if (particles[topLeft].active && particles[topRight].active &&
-                particles[bottomLeft].active && particles[bottomRight].active &&
-                gridToVertex[topLeft] != -1 && gridToVertex[topRight] != -1 &&
-                gridToVertex[bottomLeft] != -1 && gridToVertex[bottomRight] != -1) {
-                
-                // first triangle
-                indices.push_back(gridToVertex[topLeft]);
-                indices.push_back(gridToVertex[bottomLeft]);
-                indices.push_back(gridToVertex[topRight]);
-                
-                // second triangle
-                indices.push_back(gridToVertex[topRight]);
-                indices.push_back(gridToVertex[bottomLeft]);
-                indices.push_back(gridToVertex[bottomRight]);
-            }
+    deadVertices = 0;
+    meshDirty = false;
+    topologyVersion++;
+}
+
+void ClothSystem::removeParticleFromMesh(int index) {
+    normalsDirty = true;
+    if (meshDirty) return;      // rebuilt from scratch on the next update anyway
+    
+    if (particleVertex[index] >= 0) deadVertices++;
+    
+    // swap-remove the (up to four) quads the particle is a corner of
+    int px, py;
+    gridCoords(index, px, py);
+    
+    for (int y = std::max(py - 1, 0); y <= std::min(py, gridHeight - 2); ++y) {
+        for (int x = std::max(px - 1, 0); x <= std::min(px, gridWidth - 2); ++x) {
+            int quad = y * (gridWidth - 1) + x;
+            int slot = quadSlot[quad];
+            if (slot < 0) continue;
+            
+            int lastSlot = static_cast<int>(slotQuad.size()) - 1;
+            int lastQuad = slotQuad[lastSlot];
+            std::copy(indices.begin() + lastSlot * 6, indices.begin() + lastSlot * 6 + 6, indices.begin() + slot * 6);
+            quadSlot[lastQuad] = slot;
+            slotQuad[slot] = lastQuad;
+            
+            quadSlot[quad] = -1;
+            slotQuad.pop_back();
+            indices.resize(indices.size() - 6);
         }
     }
+    
+    topologyVersion++;
 }
 
-glm::vec3 ClothSystem::calculateNormal(int x, int y) const {
-    int index = y * gridWidth + x;
-    if (!particles[index].active) return glm::vec3(0.0f, 0.0f, 1.0f);
+void ClothSystem::computeNormals(bool aerodynamics) {
+    // while part of the cloth sleeps only the tile rows the last step moved are redone,
+    // the wind forces need every face
+    bool partial = !normalsDirty && !aerodynamics && sleepingTiles > 0;
     
-    glm::vec3 normal(0.0f);
-    int validNeighbors = 0;
+    if (partial) {
+        for (int band = 0; band < tilesY; ++band) {
+            if (!bandDirty[band]) continue;
+            
+            // a band of tile rows is the same block of particles in either layout
+            size_t begin = static_cast<size_t>(band * TILE_SIZE) * gridWidth;
+            size_t end = static_cast<size_t>(std::min((band + 1) * TILE_SIZE, gridHeight)) * gridWidth;
+            std::fill(normalX.begin() + begin, normalX.begin() + end, 0.0f);
+            std::fill(normalY.begin() + begin, normalY.begin() + end, 0.0f);
+            std::fill(normalZ.begin() + begin, normalZ.begin() + end, 0.0f);
+        }
+    } else {
+        std::fill(normalX.begin(), normalX.end(), 0.0f);
+        std::fill(normalY.begin(), normalY.end(), 0.0f);
+        std::fill(normalZ.begin(), normalZ.end(), 0.0f);
+    }
     
-    // sample neighboring particles for normal calculation
-    std::vector<glm::vec2> offsets = {
-        {1, 0}, {-1, 0}, {0, 1}, {0, -1},
-        {1, 1}, {-1, -1}, {1, -1}, {-1, 1}
+    if (aerodynamics) {
+        sampleWind();
+        
+        // wind streams become each particle's velocity relative to the air, from the Verlet state
+        float invDeltaTime = 1.0f / substepDeltaTime;
+        for (size_t i = 0; i < particles.paddedSize(); ++i) {
+            windX[i] = (particles.x[i] - particles.prevX[i]) * invDeltaTime - windX[i];
+            windY[i] = (particles.y[i] - particles.prevY[i]) * invDeltaTime - windY[i];
+            windZ[i] = (particles.z[i] - particles.prevZ[i]) * invDeltaTime - windZ[i];
+        }
+        
+        std::fill(aeroX.begin(), aeroX.end(), 0.0f);
+        std::fill(aeroY.begin(), aeroY.end(), 0.0f);
+        std::fill(aeroZ.begin(), aeroZ.end(), 0.0f);
+    }
+    
+    int quads = gridWidth - 1;
+    float* upperX = faceNormals.data();         // (b - a) x (c - a), triangle (a, c, b)
+    float* upperY = upperX + quads;
+    float* upperZ = upperY + quads;
+    float* lowerX = upperZ + quads;             // (d - b) x (c - b), triangle (b, c, d)
+    float* lowerY = lowerX + quads;
+    float* lowerZ = lowerY + quads;
+    float* quadAlive = lowerZ + quads;
+    float* upperFX = quadAlive + quads;         // aerodynamic force per corner of each face
+    float* upperFY = upperFX + quads;
+    float* upperFZ = upperFY + quads;
+    float* lowerFX = upperFZ + quads;
+    float* lowerFY = lowerFX + quads;
+    float* lowerFZ = lowerFY + quads;
+    
+    // coefficients are per unit mass, every face hands a third of its force to each corner and
+    // takes corner velocity sums rather than means below (1/9)
+    float dragScale = faceMass * aeroDrag / 27.0f;
+    float liftScale = faceMass * aeroLift / 27.0f;
+    
+    // one particle row as the sweep sees it - row-major rows are used in place, tiled rows are
+    // gathered into rowScratch and their sums added back once both quad rows next to them are done
+    struct RowView {
+        const float *x, *y, *z;             // position
+        const float *ux, *uy, *uz;          // velocity relative to the air
+        float *nx, *ny, *nz;                // normal sums
+        float *fx, *fy, *fz;                // aerodynamic force sums
+        const int* index;                   // particle per entry, null if in place
+        int first;                          // particle of entry 0 if in place
+        
+        int particle(int x) const { return index ? index[x] : first + x; }
+    };
+    
+    bool tiled = layout == ParticleLayout::TILES;
+    size_t width = gridWidth;
+    
+    auto viewRow = [&](int y) {
+        RowView view;
+        if (!tiled) {
+            int first = particleIndex(0, y);
+            view = { particles.x.data() + first, particles.y.data() + first, particles.z.data() + first,
+                     windX.data() + first, windY.data() + first, windZ.data() + first,
+                     normalX.data() + first, normalY.data() + first, normalZ.data() + first,
+                     aeroX.data() + first, aeroY.data() + first, aeroZ.data() + first,
+                     nullptr, first };
+            return view;
+        }
+        
+        // 12 streams of one row per scratch slot, rows alternate between the two slots
+        float* scratch = rowScratch.data() + (y & 1) * 12 * width;
+        int* index = rowParticles.data() + (y & 1) * width;
+        for (int x = 0; x < gridWidth; ++x) {
+            index[x] = particleIndex(x, y);
+        }
+        for (size_t x = 0; x < width; ++x) {
+            scratch[x] = particles.x[index[x]];
+            scratch[width + x] = particles.y[index[x]];
+            scratch[2 * width + x] = particles.z[index[x]];
+        }
+        if (aerodynamics) {
+            for (size_t x = 0; x < width; ++x) {
+                scratch[3 * width + x] = windX[index[x]];
+                scratch[4 * width + x] = windY[index[x]];
+                scratch[5 * width + x] = windZ[index[x]];
+            }
+        }
+        std::fill(scratch + 6 * width, scratch + 12 * width, 0.0f);
+        
+        view = { scratch, scratch + width, scratch + 2 * width,
+                 scratch + 3 * width, scratch + 4 * width, scratch + 5 * width,
+                 scratch + 6 * width, scratch + 7 * width, scratch + 8 * width,
+                 scratch + 9 * width, scratch + 10 * width, scratch + 11 * width,
+                 index, 0 };
+        return view;
+    };
+    
+    auto finishRow = [&](int y, const RowView& view) {
+        if (!view.index || (partial && !bandDirty[y / TILE_SIZE])) return;
+        
+        for (size_t x = 0; x < width; ++x) {
+            normalX[view.index[x]] += view.nx[x];
+            normalY[view.index[x]] += view.ny[x];
+            normalZ[view.index[x]] += view.nz[x];
+        }
+        if (!aerodynamics) return;
+        for (size_t x = 0; x < width; ++x) {
+            aeroX[view.index[x]] += view.fx[x];
+            aeroY[view.index[x]] += view.fy[x];
+            aeroZ[view.index[x]] += view.fz[x];
+        }
     };
     
-    for (size_t i = 0; i < offsets.size() - 1; ++i) {
-        int x1 = x + offsets[i].x;
-        int y1 = y + offsets[i].y;
-        int x2 = x + offsets[i + 1].x;
-        int y2 = y + offsets[i + 1].y;
+    // one sweep over the quad rows - face normals for a whole row first, then area weighted
+    // adds into the two particle rows it touches; every loop is branch free and contiguous
+    RowView top, bottom;
+    int topRow = -1;
+    for (int y = 0; y < gridHeight - 1; ++y) {
+        // a quad row adds into the particle rows above and below it, each only if that row was cleared
+        bool writeRow = !partial || bandDirty[y / TILE_SIZE];
+        bool writeNext = !partial || bandDirty[(y + 1) / TILE_SIZE];
+        if (!writeRow && !writeNext) continue;
+        
+        // the row below of the last quad row is this one's row above, unless that was skipped
+        if (topRow != y) top = viewRow(y);
+        bottom = viewRow(y + 1);
         
-        if (x1 >= 0 && x1 < gridWidth && y1 >= 0 && y1 < gridHeight &&
-            x2 >= 0 && x2 < gridWidth && y2 >= 0 && y2 < gridHeight) {
+        // torn quads are not rendered and contribute nothing
+        for (int x = 0; x < quads; ++x) {
+            bool alive = particles.isActive(top.particle(x)) && particles.isActive(top.particle(x + 1)) &&
+                         particles.isActive(bottom.particle(x)) && particles.isActive(bottom.particle(x + 1));
+            quadAlive[x] = alive ? 1.0f : 0.0f;
+        }
+        
+        const float* ax = top.x;            const float* ay = top.y;            const float* az = top.z;
+        const float* cx = bottom.x;         const float* cy = bottom.y;         const float* cz = bottom.z;
+        
+        for (int x = 0; x < quads; ++x) {
+            float e1x = ax[x + 1] - ax[x], e1y = ay[x + 1] - ay[x], e1z = az[x + 1] - az[x];
+            float e2x = cx[x] - ax[x],     e2y = cy[x] - ay[x],     e2z = cz[x] - az[x];
+            float e3x = cx[x + 1] - ax[x + 1], e3y = cy[x + 1] - ay[x + 1], e3z = cz[x + 1] - az[x + 1];
+            float e4x = cx[x] - ax[x + 1],     e4y = cy[x] - ay[x + 1],     e4z = cz[x] - az[x + 1];
+            float w = quadAlive[x];
             
-            int idx1 = y1 * gridWidth + x1;
-            int idx2 = y2 * gridWidth + x2;
+            upperX[x] = (e1y * e2z - e1z * e2y) * w;
+            upperY[x] = (e1z * e2x - e1x * e2z) * w;
+            upperZ[x] = (e1x * e2y - e1y * e2x) * w;
+            lowerX[x] = (e3y * e4z - e3z * e4y) * w;
+            lowerY[x] = (e3z * e4x - e3x * e4z) * w;
+            lowerZ[x] = (e3x * e4y - e3y * e4x) * w;
+        }
+        
+        // a = (x, y) gets the upper face, b = (x + 1, y) both
+        if (writeRow) {
+            for (int x = 0; x < quads; ++x) {
+                top.nx[x] += upperX[x];
+                top.ny[x] += upperY[x];
+                top.nz[x] += upperZ[x];
+            }
+            for (int x = 0; x < quads; ++x) {
+                top.nx[x + 1] += upperX[x] + lowerX[x];
+                top.ny[x + 1] += upperY[x] + lowerY[x];
+                top.nz[x + 1] += upperZ[x] + lowerZ[x];
+            }
+        }
+        
+        // c = (x, y + 1) gets both faces, d = (x + 1, y + 1) the lower one
+        if (writeNext) {
+            for (int x = 0; x < quads; ++x) {
+                bottom.nx[x] += upperX[x] + lowerX[x];
+                bottom.ny[x] += upperY[x] + lowerY[x];
+                bottom.nz[x] += upperZ[x] + lowerZ[x];
+            }
+            for (int x = 0; x < quads; ++x) {
+                bottom.nx[x + 1] += lowerX[x];
+                bottom.ny[x + 1] += lowerY[x];
+                bottom.nz[x + 1] += lowerZ[x];
+            }
+        }
+        
+        if (aerodynamics) {
+            // each face moves through the air with the mean velocity of its corners, torn faces have
+            // a zero normal and feel nothing - the forces are quadratic in the velocity, so the corner
+            // sums go in as they are and the 1/3 is squared into the scales
+            const float* ux = top.ux;       const float* uy = top.uy;       const float* uz = top.uz;
+            const float* vx = bottom.ux;    const float* vy = bottom.uy;    const float* vz = bottom.uz;
             
-            if (particles[idx1].active && particles[idx2].active) {
-                glm::vec3 v1 = particles[idx1].position - particles[index].position;
-                glm::vec3 v2 = particles[idx2].position - particles[index].position;
-                normal += glm::cross(v1, v2);
-                validNeighbors++;
+            for (int x = 0; x < quads; ++x) {
+                glm::vec3 upperVelocity = glm::vec3(ux[x] + ux[x + 1] + vx[x], uy[x] + uy[x + 1] + vy[x], uz[x] + uz[x + 1] + vz[x]);
+                glm::vec3 lowerVelocity = glm::vec3(ux[x + 1] + vx[x] + vx[x + 1], uy[x + 1] + vy[x] + vy[x + 1], uz[x + 1] + vz[x] + vz[x + 1]);
+                
+                glm::vec3 upper = triangleAerodynamics(glm::vec3(upperX[x], upperY[x], upperZ[x]), upperVelocity, dragScale, liftScale);
+                glm::vec3 lower = triangleAerodynamics(glm::vec3(lowerX[x], lowerY[x], lowerZ[x]), lowerVelocity, dragScale, liftScale);
+                
+                upperFX[x] = upper.x;   upperFY[x] = upper.y;   upperFZ[x] = upper.z;
+                lowerFX[x] = lower.x;   lowerFY[x] = lower.y;   lowerFZ[x] = lower.z;
+            }
+            
+            // same scatter as the normals
+            for (int x = 0; x < quads; ++x) {
+                top.fx[x] += upperFX[x];
+                top.fy[x] += upperFY[x];
+                top.fz[x] += upperFZ[x];
+                top.fx[x + 1] += upperFX[x] + lowerFX[x];
+                top.fy[x + 1] += upperFY[x] + lowerFY[x];
+                top.fz[x + 1] += upperFZ[x] + lowerFZ[x];
+            }
+            for (int x = 0; x < quads; ++x) {
+                bottom.fx[x] += upperFX[x] + lowerFX[x];
+                bottom.fy[x] += upperFY[x] + lowerFY[x];
+                bottom.fz[x] += upperFZ[x] + lowerFZ[x];
+                bottom.fx[x + 1] += lowerFX[x];
+                bottom.fy[x + 1] += lowerFY[x];
+                bottom.fz[x + 1] += lowerFZ[x];
             }
         }
+        
+        // the row above has had both its quad rows
+        finishRow(y, top);
+        top = bottom;
+        topRow = y + 1;
     }
+    if (topRow == gridHeight - 1) finishRow(topRow, top);
     
-    if (validNeighbors > 0) {
-        normal = glm::normalize(normal);
-    } else {
-        normal = glm::vec3(0.0f, 0.0f, 1.0f);
-    }
-    
-    return normal;
+    normalsDirty = false;
 }
 
 void ClothSystem::setMode(SimulationMode mode) {
@@ -351,7 +1490,7 @@ void ClothSystem::setMode(SimulationMode mode) {
             windStrength = 0.0f;
             // standard - top side pinned
             for (int x = 0; x < gridWidth; ++x) {
-                particles[(gridHeight - 1) * gridWidth + x].pinned = true;
+                particles.setPinned(particleIndex(x, gridHeight - 1), true);
             }
             break;
             
@@ -362,8 +1501,8 @@ void ClothSystem::setMode(SimulationMode mode) {
             windStrength = 0.0f;
             
             // pin top corners so cloth "hangs"
-            particles[(gridHeight - 1) * gridWidth].pinned = true;                      // top-left
-            particles[(gridHeight - 1) * gridWidth + (gridWidth - 1)].pinned = true;    // top-right
+            particles.setPinned(particleIndex(0, gridHeight - 1), true);                // top-left
+            particles.setPinned(particleIndex(gridWidth - 1, gridHeight - 1), true);    // top-right
             break;
             
         case SimulationMode::FLAG:
@@ -374,42 +1513,90 @@ void ClothSystem::setMode(SimulationMode mode) {
             
             // for flag, pin top edge
             for (int x = 0; x < gridWidth; ++x) {
-                particles[(gridHeight - 1) * gridWidth + x].pinned = true;
+                particles.setPinned(particleIndex(x, gridHeight - 1), true);
             }
             break;
     }
+    
+    // the mode's spheres appear where they are, not interpolated in from nowhere
+    storeRenderState();
+}
+
+void ClothSystem::setFixedTimeStep(float seconds) {
+    fixedTimeStep = std::max(seconds, 1e-4f);
+    scheduler.setFixedTimeStep(fixedTimeStep);
 }
 
 void ClothSystem::handleMouseInteraction(const glm::vec3& mousePos, bool tearing) {
     if (!tearing) return;
     
-    // find particles within tear radius
-    float tearRadius = 0.08f;
+    // particles only move in update(), so one index serves every mouse event in between
+    if (spatialIndexDirty) {
+        spatialIndex.build(particles, tearRadius);
+        spatialIndexDirty = false;
+    }
     
-    for (size_t i = 0; i < particles.size(); ++i) {
-        if (!particles[i].active) continue;
+    // find particles within tear radius
+    spatialIndex.forEachInRadius(particles, mousePos, tearRadius, [&](int i) {
+        if (!particles.isActive(i)) return;
         
-        float distance = glm::length(particles[i].position - mousePos);
-        if (distance < tearRadius) {
-            // deactivate particle
-            particles[i].active = false;
-            
-            // deactivate connected springs
-            for (auto& spring : springs) {
-                int j = static_cast<int>(i);
-                if (spring.particle1 == j || spring.particle2 == j) {
-                    spring.active = false;
-                }
-            }
+        // deactivate particle
+        int island = islands.islandOf(i);
+        if (island >= 0) wakeIsland(island);
+        islands.removeParticle(i);
+        particles.setActive(i, false);
+        removeParticleFromMesh(i);
+        
+        // deactivate connected springs - each removal shrinks the particle's row
+        SpringIncidence::Range connected = incidence.springsOf(i);
+        while (!connected.empty()) {
+            deactivateSpring(*connected.begin());
+            connected = incidence.springsOf(i);
         }
+    });
+}
+
+void ClothSystem::setParticleLayout(ParticleLayout order) {
+    layout = order;
+    reset();
+}
+
+void ClothSystem::setSolverMode(SolverMode mode) {
+    // a different solver settles to a different shape
+    if (mode != solverMode) wakeAll();
+    solverMode = mode;
+}
+
+void ClothSystem::applyDefaultSplit() {
+    // PBD keeps the original 3 iterations per step, XPBD trades them for substeps
+    setSubsteps(solverMode == SolverMode::XPBD ? 8 : 1);
+    setSolverIterations(solverMode == SolverMode::XPBD ? 1 : 3);
+}
+
+void ClothSystem::setCompliance(Spring::SpringType type, float compliance) {
+    if (compliance != typeCompliance[type]) wakeAll();
+    typeCompliance[type] = compliance;
+    
+    for (auto& spring : springs) {
+        if (spring.type == type) spring.compliance = compliance;
     }
 }
 
 void ClothSystem::reset() {
+    // a fresh cloth owes no time from the old one
+    scheduler.reset();
+    windStep = 0;
+    windField.reset();
     createClothGrid();
 }
 
 void ClothSystem::addSphere(const glm::vec3& center, float radius) {
+    // the first sphere is the one updateObjectMovement animates, from where it was placed
+    if (spheres.empty()) {
+        objectStartPos = center;
+        objectAngle = 0.0f;
+        objectGoingForward = true;
+    }
     spheres.emplace_back(center, radius);
 }
 
@@ -420,53 +1607,36 @@ void ClothSystem::clearCollisionObjects() {
 void ClothSystem::updateObjectMovement(float deltaTime) {
     if (spheres.empty()) return;
 
-    static glm::vec3 startPos = spheres[0].center;
-    static float angle = 0.0f;   // tracks semicircle motion
-    static bool goingForward = true;
-
     objectMoveTime += deltaTime * objectMoveSpeed;
     float radius = objectMoveRange * 0.5f;  // half of old back-and-forth
 
-    if (goingForward) {
+    if (objectGoingForward) {
         // move straight toward camera along Z
-        spheres[0].center.z = startPos.z - objectMoveTime;
+        spheres[0].center.z = objectStartPos.z - objectMoveTime;
 
         // once we reach the forward point, start semicircle
-        if (spheres[0].center.z <= startPos.z - objectMoveRange) {
-            goingForward = false;
-            angle = 0.0f; 
+        if (spheres[0].center.z <= objectStartPos.z - objectMoveRange) {
+            objectGoingForward = false;
+            objectAngle = 0.0f; 
         }
 
     } else {
         // semicircle around back to original pos
-        angle += deltaTime * objectMoveSpeed;
+        objectAngle += deltaTime * objectMoveSpeed;
 
-        float x = startPos.x + radius * sin(angle);                  
-        float z = (startPos.z - objectMoveRange) + radius * (1 - cos(angle)); 
+        float x = objectStartPos.x + radius * sin(objectAngle);                  
+        float z = (objectStartPos.z - objectMoveRange) + radius * (1 - cos(objectAngle)); 
 
-        spheres[0].center = glm::vec3(x, startPos.y, z);
+        spheres[0].center = glm::vec3(x, objectStartPos.y, z);
 
-        if (angle >= 3.14159f) {
-            goingForward = true;
+        if (objectAngle >= 3.14159f) {
+            objectGoingForward = true;
             objectMoveTime = 0.0f;
-            spheres[0].center = startPos;
+            spheres[0].center = objectStartPos;
         }
     }
 }
 
 void ClothSystem::updateWindVariation(float deltaTime) {
-    // only add wind variation in flag mode
-    if (windStrength < 1.0f) return;
-
-    windVariationTime += deltaTime * 3.0f; 
-    
-    float variationX = sin(windVariationTime * 1.5f) * windVariationStrength;
-    float variationY = sin(windVariationTime * 2.3f) * windVariationStrength * 0.5f;
-    float variationZ = cos(windVariationTime * 1.8f) * windVariationStrength * 0.3f;
-    
-    // apply variations to base wind direction
-    glm::vec3 baseWind = glm::normalize(glm::vec3(0.0f, 0.0f, -1.0f));
-    glm::vec3 variedWind = baseWind + glm::vec3(variationX, variationY, variationZ);
-
-    windDirection = glm::normalize(variedWind);
+    windField.advance(deltaTime);
 }
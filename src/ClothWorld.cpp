@@ -0,0 +1,67 @@
+#include "ClothWorld.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ClothWorld::ClothWorld() : threadPool(&ThreadPool::shared()) {}
+
+ClothSystem& ClothWorld::addCloth(int width, int height, float w, float h, const glm::vec3& origin) {
+    cloths.push_back(std::make_unique<ClothSystem>(width, height, w, h, origin));
+    
+    ClothSystem& cloth = *cloths.back();
+    cloth.setSharedColliders(&colliders);
+    return cloth;
+}
+
+void ClothWorld::removeCloth(size_t index) {
+    cloths.erase(cloths.begin() + index);
+}
+
+void ClothWorld::clear() {
+    cloths.clear();
+}
+
+void ClothWorld::addCollider(const glm::vec3& center, float radius) {
+    colliders.emplace_back(center, radius);
+}
+
+void ClothWorld::clearColliders() {
+    colliders.clear();
+}
+
+size_t ClothWorld::getParticleCount() const {
+    size_t count = 0;
+    for (const auto& cloth : cloths) {
+        count += cloth->getParticleCount();
+    }
+    return count;
+}
+
+void ClothWorld::update(float deltaTime) {
+    if (cloths.empty()) return;
+    
+    // a cloth bigger than one thread's share would leave the others idle at the end of the
+    // concurrent pass, it steps on its own and spreads its loops over the whole pool instead
+    size_t share = getParticleCount() / threadPool->size();
+    
+    concurrent.clear();
+    for (const auto& cloth : cloths) {
+        if (threadPool->size() > 1 && cloth->getParticleCount() > share) {
+            cloth->update(deltaTime);
+        } else {
+            concurrent.push_back(cloth.get());
+        }
+    }
+    
+    // biggest first, so what is left to steal near the end is small
+    std::sort(concurrent.begin(), concurrent.end(), [](const ClothSystem* a, const ClothSystem* b) {
+        return a->getParticleCount() > b->getParticleCount();
+    });
+    
+    // loops inside each cloth run inline on the thread stepping it
+    threadPool->parallelFor(concurrent.size(), 1, [this, deltaTime](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            concurrent[i]->update(deltaTime);
+        }
+    });
+}
@@ -0,0 +1,72 @@
+#include "ConstraintColoring.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void ConstraintColoring::reset(size_t particleCount, size_t springCount) {
+    particleColors.assign(particleCount, 0);
+    springColor.assign(springCount, -1);
+    batchSlot.assign(springCount, -1);
+    batches.clear();
+    batchEdits.clear();
+}
+
+void ConstraintColoring::add(int spring, int particle1, int particle2) {
+    if (contains(spring)) return;
+
+    // a particle has at most 12 incident springs, greedy never needs more than 23 colors
+    uint64_t used = particleColors[particle1] | particleColors[particle2];
+    if (~used == 0) {
+        throw std::runtime_error("ConstraintColoring: out of colors");
+    }
+
+    int color = 0;
+    while (used & (uint64_t(1) << color)) ++color;
+
+    if (color >= static_cast<int>(batches.size())) {
+        batches.resize(color + 1);
+        batchEdits.resize(color + 1, 0);
+    }
+
+    particleColors[particle1] |= uint64_t(1) << color;
+    particleColors[particle2] |= uint64_t(1) << color;
+
+    springColor[spring] = color;
+    batchSlot[spring] = static_cast<int>(batches[color].size());
+    batches[color].push_back(spring);
+    batchEdits[color]++;
+}
+
+void ConstraintColoring::remove(int spring, int particle1, int particle2) {
+    int color = springColor[spring];
+    if (color < 0) return;
+
+    // proper coloring - this was the only spring of its color at either particle
+    particleColors[particle1] &= ~(uint64_t(1) << color);
+    particleColors[particle2] &= ~(uint64_t(1) << color);
+
+    // swap-remove, sortStaleBatches restores the order once enough of it is lost
+    std::vector<int>& batch = batches[color];
+    int slot = batchSlot[spring];
+    int moved = batch.back();
+    batch[slot] = moved;
+    batchSlot[moved] = slot;
+    batch.pop_back();
+    batchEdits[color]++;
+
+    springColor[spring] = -1;
+    batchSlot[spring] = -1;
+}
+
+void ConstraintColoring::sortStaleBatches() {
+    for (size_t color = 0; color < batches.size(); ++color) {
+        std::vector<int>& batch = batches[color];
+        if (batchEdits[color] * 4 <= static_cast<int>(batch.size())) continue;
+
+        std::sort(batch.begin(), batch.end());
+        for (size_t slot = 0; slot < batch.size(); ++slot) {
+            batchSlot[batch[slot]] = static_cast<int>(slot);
+        }
+        batchEdits[color] = 0;
+    }
+}
@@ -1,6 +1,8 @@
 #include "Renderer.h"
-#include "ClothSystem.h"
+#include "SimulationThread.h"
 #include "Camera.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -263,7 +265,7 @@ unsigned int Skybox::loadCubemap() {
     return textureID;
 }
 
-Renderer::Renderer() : clothVAO(0), clothVBO(0), clothEBO(0), clothTexture(0),
+Renderer::Renderer() : clothVAO(0), clothEBO(0), clothTexCoordVBO(0), clothTexture(0),
                       sphereVAO(0), sphereVBO(0), sphereEBO(0) {}
 
 Renderer::~Renderer() {
@@ -294,28 +296,57 @@ bool Renderer::initialize() {
 
 void Renderer::setupClothBuffers() {
     glGenVertexArrays(1, &clothVAO);
-    glGenBuffers(1, &clothVBO);
+    glGenBuffers(1, &clothTexCoordVBO);
     glGenBuffers(1, &clothEBO);
     
+    // positions and normals stream through ring buffers, their attribute pointers
+    // are set per frame to the region just written
+    clothPositions = std::make_unique<StreamBuffer>(3 * sizeof(float));
+    clothPreviousPositions = std::make_unique<StreamBuffer>(3 * sizeof(float));
+    clothNormals = std::make_unique<StreamBuffer>(3 * sizeof(float));
+    
     glBindVertexArray(clothVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, clothVBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, clothEBO);
     
+    // one tightly packed buffer per attribute
     // position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
     
     // normal 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
     
+    // position at the start of the last step, blended with the current one in the shader
+    glEnableVertexAttribArray(3);
+    
     // texture coord
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, clothTexCoordVBO);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(2);
     
     glBindVertexArray(0);
 }
 
+void Renderer::attachVertexRing(VertexRing& ring, size_t vertexCapacity) {
+    if (!GLEW_ARB_buffer_storage || vertexCapacity == 0) return;
+    
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(VertexRing::REGIONS * vertexCapacity * VertexRing::STREAMS * sizeof(float));
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    
+    glGenBuffers(1, &vertexRingBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexRingBuffer);
+    glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+    void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+    
+    if (!mapped) {
+        glDeleteBuffers(1, &vertexRingBuffer);
+        vertexRingBuffer = 0;
+        return;
+    }
+    
+    ring.attach(static_cast<float*>(mapped), vertexCapacity);
+    vertexRing = &ring;
+}
+
 void Renderer::setupCollisionObjectBuffers() {
     // sphere VAO
     glGenVertexArrays(1, &sphereVAO);
@@ -375,17 +406,17 @@ void Renderer::generateSphereMesh(float radius, int segments) {
     }
 }
 
-void Renderer::createScene(const ClothSystem& cloth, const Camera& camera, bool wireframe) {
+void Renderer::createScene(const ClothSnapshot& cloth, const Camera& camera, bool wireframe, float alpha) {
     // render skybox first (background)
     if (skybox) {
         skybox->render(camera.getViewMatrix(), camera.getProjectionMatrix(1920.0f / 1080.0f));
     }
     
-    renderCloth(cloth, camera, wireframe);
-    renderCollisionObjects(cloth, camera);
+    renderCloth(cloth, camera, wireframe, alpha);
+    renderCollisionObjects(cloth, camera, alpha);
 }
 
-void Renderer::renderCloth(const ClothSystem& cloth, const Camera& camera, bool wireframe) {
+void Renderer::renderCloth(const ClothSnapshot& cloth, const Camera& camera, bool wireframe, float alpha) {
     clothShader->use();
     
     // set uniforms
@@ -402,19 +433,28 @@ void Renderer::renderCloth(const ClothSystem& cloth, const Camera& camera, bool
     clothShader->setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
     clothShader->setVec3("clothColor", glm::vec3(0.9f, 0.9f, 0.95f)); 
     clothShader->setBool("wireframe", wireframe);
+    clothShader->setFloat("alpha", alpha);
     
     // bind cloth data - now using fiber data instead of triangular mesh
     glBindVertexArray(clothVAO);
     
-    const auto& fiberVertices = cloth.getVertices();
-    const auto& fiberIndices = cloth.getIndices();
+    size_t vertexCount = cloth.getVertexCount();
+    const auto& fiberIndices = cloth.indices;
     
-    if (!fiberVertices.empty() && !fiberIndices.empty()) {
-        glBindBuffer(GL_ARRAY_BUFFER, clothVBO);
-        glBufferData(GL_ARRAY_BUFFER, fiberVertices.size() * sizeof(float), fiberVertices.data(), GL_DYNAMIC_DRAW);
+    if (vertexCount > 0 && !fiberIndices.empty()) {
+        bindClothStreams(cloth);
         
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, clothEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, fiberIndices.size() * sizeof(unsigned int), fiberIndices.data(), GL_DYNAMIC_DRAW);
+        // indices and texture coords only change when the cloth tears or resets
+        if (!clothTopologyUploaded || cloth.topologyVersion != clothTopologyVersion) {
+            const auto& texCoords = cloth.texCoords;
+            glBindBuffer(GL_ARRAY_BUFFER, clothTexCoordVBO);
+            glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(float), texCoords.data(), GL_STATIC_DRAW);
+            
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, clothEBO);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, fiberIndices.size() * sizeof(unsigned int), fiberIndices.data(), GL_DYNAMIC_DRAW);
+            clothTopologyVersion = cloth.topologyVersion;
+            clothTopologyUploaded = true;
+        }
         
         // so we can render cloth from both sides
         glDisable(GL_CULL_FACE);
@@ -428,6 +468,7 @@ void Renderer::renderCloth(const ClothSystem& cloth, const Camera& camera, bool
         }
         
         glDrawElements(GL_TRIANGLES, fiberIndices.size(), GL_UNSIGNED_INT, 0);
+        fenceClothStreams(cloth);
         
         // reset polygon mode and re-enable face culling
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -437,7 +478,81 @@ void Renderer::renderCloth(const ClothSystem& cloth, const Camera& camera, bool
     glBindVertexArray(0);
 }
 
-void Renderer::renderCollisionObjects(const ClothSystem& cloth, const Camera& camera) {
+void Renderer::bindClothStreams(const ClothSnapshot& cloth) {
+    // written by the simulation thread straight into the ring, only the pointers move
+    if (cloth.vertexSequence != 0) {
+        size_t region = vertexRing->offsetOf(cloth.vertexSequence) * sizeof(float);
+        size_t stream = 3 * vertexRing->getCapacity() * sizeof(float);
+        
+        glBindBuffer(GL_ARRAY_BUFFER, vertexRingBuffer);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)region);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(region + stream));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(region + 2 * stream));
+        return;
+    }
+    
+    // the snapshot's own copy - a cloth at rest draws again from the regions it was last copied to
+    size_t vertexCount = cloth.getVertexCount();
+    bool uploaded = clothTopologyUploaded && cloth.atRest && cloth.topologyVersion == clothTopologyVersion &&
+                    cloth.renderVersion == clothRenderVersion;
+    
+    if (!uploaded) {
+        size_t bytes = vertexCount * 3 * sizeof(float);
+        clothPositions->reserve(vertexCount);
+        clothPreviousPositions->reserve(vertexCount);
+        clothNormals->reserve(vertexCount);
+        
+        std::memcpy(clothPositions->map(), cloth.positions.data(), bytes);
+        std::memcpy(clothPreviousPositions->map(), cloth.previousPositions.data(), bytes);
+        std::memcpy(clothNormals->map(), cloth.normals.data(), bytes);
+        clothPositions->unmap(vertexCount);
+        clothPreviousPositions->unmap(vertexCount);
+        clothNormals->unmap(vertexCount);
+        clothRenderVersion = cloth.renderVersion;
+    }
+    
+    glBindBuffer(GL_ARRAY_BUFFER, clothPositions->getID());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)clothPositions->offset());
+    glBindBuffer(GL_ARRAY_BUFFER, clothPreviousPositions->getID());
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)clothPreviousPositions->offset());
+    glBindBuffer(GL_ARRAY_BUFFER, clothNormals->getID());
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)clothNormals->offset());
+}
+
+void Renderer::fenceClothStreams(const ClothSnapshot& cloth) {
+    if (cloth.vertexSequence == 0) {
+        clothPositions->fence();
+        clothPreviousPositions->fence();
+        clothNormals->fence();
+    } else {
+        int region = VertexRing::regionOf(cloth.vertexSequence);
+        if (vertexRingFences[region]) glDeleteSync(vertexRingFences[region]);
+        vertexRingFences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        vertexRingFenced[region] = cloth.vertexSequence;
+        vertexRingDrawn = cloth.vertexSequence;
+    }
+    
+    if (!vertexRing) return;
+    
+    // the snapshot just drawn may be drawn again next frame, older regions stay
+    // in use until the GPU signals their fence - snapshots never go back, so a
+    // copied one frees everything up to the last region drawn
+    uint64_t oldest = cloth.vertexSequence != 0 ? cloth.vertexSequence : vertexRingDrawn + 1;
+    for (int region = 0; region < VertexRing::REGIONS; ++region) {
+        GLsync& sync = vertexRingFences[region];
+        if (!sync) continue;
+        
+        if (glClientWaitSync(sync, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            oldest = std::min(oldest, vertexRingFenced[region]);
+        } else {
+            glDeleteSync(sync);
+            sync = nullptr;
+        }
+    }
+    vertexRing->release(oldest);
+}
+
+void Renderer::renderCollisionObjects(const ClothSnapshot& cloth, const Camera& camera, float alpha) {
     objectShader->use();
     
     glm::mat4 view = camera.getViewMatrix();
@@ -466,9 +581,15 @@ void Renderer::renderCollisionObjects(const ClothSystem& cloth, const Camera& ca
     glEnableVertexAttribArray(2);
     
     // render sphere collision
-    for (const auto& sphere : cloth.getSpheres()) {
+    for (size_t i = 0; i < cloth.spheres.size(); ++i) {
+        const auto& sphere = cloth.spheres[i];
+        glm::vec3 center = sphere.center;
+        if (i < cloth.previousSphereCenters.size()) {
+            center = glm::mix(cloth.previousSphereCenters[i], sphere.center, alpha);
+        }
+        
         glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, sphere.center);
+        model = glm::translate(model, center);
         model = glm::scale(model, glm::vec3(sphere.radius));
         
         objectShader->setMat4("model", model);
@@ -481,11 +602,19 @@ void Renderer::renderCollisionObjects(const ClothSystem& cloth, const Camera& ca
 }
 
 void Renderer::cleanup() {
-    if (clothVAO)       glDeleteVertexArrays(1, &clothVAO);
-    if (clothVBO)       glDeleteBuffers(1, &clothVBO);
-    if (clothEBO)       glDeleteBuffers(1, &clothEBO);
-    if (sphereVAO)      glDeleteVertexArrays(1, &sphereVAO);
-    if (sphereVBO)      glDeleteBuffers(1, &sphereVBO);
-    if (sphereEBO)      glDeleteBuffers(1, &sphereEBO);
-    if (clothTexture)   glDeleteTextures(1, &clothTexture);
+    if (clothVAO)           glDeleteVertexArrays(1, &clothVAO);
+    clothPositions.reset();
+    clothPreviousPositions.reset();
+    clothNormals.reset();
+    for (GLsync& sync : vertexRingFences) {
+        if (sync) glDeleteSync(sync);
+        sync = nullptr;
+    }
+    if (vertexRingBuffer)   glDeleteBuffers(1, &vertexRingBuffer);
+    if (clothTexCoordVBO)   glDeleteBuffers(1, &clothTexCoordVBO);
+    if (clothEBO)           glDeleteBuffers(1, &clothEBO);
+    if (sphereVAO)          glDeleteVertexArrays(1, &sphereVAO);
+    if (sphereVBO)          glDeleteBuffers(1, &sphereVBO);
+    if (sphereEBO)          glDeleteBuffers(1, &sphereEBO);
+    if (clothTexture)       glDeleteTextures(1, &clothTexture);
 }
@@ -0,0 +1,554 @@
+#include "SimdKernels.h"
+#include "CounterRandom.h"
+#include "ParticleStore.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CLOTH_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// per-function ISA selection so the rest of the build keeps its baseline flags
+#if defined(__GNUC__) || defined(__clang__)
+#define CLOTH_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CLOTH_TARGET(isa)
+#endif
+
+namespace {
+
+// bitmask of free (active, not pinned and awake) particles in [i, i + lanes), lanes <= 16
+// i is always a multiple of lanes so a group never straddles two words
+inline unsigned freeLanes(const ParticleStore& p, std::size_t i, unsigned lanes) {
+    std::size_t word = i >> 6;
+    std::uint64_t bits = p.activeBits[word] & ~p.pinnedBits[word] & ~p.sleepingBits[word];
+    return static_cast<unsigned>(bits >> (i & 63)) & ((1u << lanes) - 1);
+}
+
+void applyGravityScalar(ParticleStore& p, float gravity) {
+    for (std::size_t i = 0; i < p.size(); ++i) {
+        if (!p.isFree(i)) continue;
+
+        p.forceX[i] = 0.0f;
+        p.forceY[i] = gravity / p.invMass[i];
+        p.forceZ[i] = 0.0f;
+    }
+}
+
+void integrateVerletScalar(ParticleStore& p, float damping, float deltaTime) {
+    float dt2 = deltaTime * deltaTime;
+
+    for (std::size_t i = 0; i < p.size(); ++i) {
+        if (!p.isFree(i)) continue;
+
+        float scale = p.invMass[i] * dt2;
+        float x = p.x[i];
+        float y = p.y[i];
+        float z = p.z[i];
+
+        p.x[i] = x + (x - p.prevX[i]) * damping + p.forceX[i] * scale;
+        p.y[i] = y + (y - p.prevY[i]) * damping + p.forceY[i] * scale;
+        p.z[i] = z + (z - p.prevZ[i]) * damping + p.forceZ[i] * scale;
+
+        p.prevX[i] = x;
+        p.prevY[i] = y;
+        p.prevZ[i] = z;
+    }
+}
+
+void addTurbulenceScalar(const WindTurbulence& t, float* velocityX, float* velocityY, float* velocityZ,
+                         std::size_t begin, std::size_t end) {
+    using namespace CounterRandom;
+
+    for (std::size_t i = begin; i < end; ++i) {
+        uint32_t counter = static_cast<uint32_t>(i);
+        velocityX[i] += signedUnit(bits(t.keyX, counter)) * t.amplitudeX;
+        velocityY[i] += signedUnit(bits(t.keyY, counter)) * t.amplitudeY;
+        velocityZ[i] += signedUnit(bits(t.keyZ, counter)) * t.amplitudeZ;
+    }
+}
+
+void sampleWindScalar(const GustField& g, const float* x, const float* y, const float* z,
+                      float* velocityX, float* velocityY, float* velocityZ, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        float wx = g.baseX;
+        float wy = g.baseY;
+        float wz = g.baseZ;
+
+        for (int f = 0; f < g.frontCount; ++f) {
+            float s = x[i] * g.waveX[f] + y[i] * g.waveY[f] + z[i] * g.waveZ[f] + g.phase[f];
+            float u = s - std::floor(s);
+            float pulse = 4.0f * u * (1.0f - u);
+            pulse = pulse * pulse;
+
+            wx += pulse * g.pushX[f];
+            wy += pulse * g.pushY[f];
+            wz += pulse * g.pushZ[f];
+        }
+
+        velocityX[i] = wx;
+        velocityY[i] = wy;
+        velocityZ[i] = wz;
+    }
+}
+
+#ifdef CLOTH_SIMD_X86
+
+// SSE4.2 - 4 particles per iteration
+
+CLOTH_TARGET("sse4.2")
+inline __m128 laneMaskSSE(unsigned bits) {
+    const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+    __m128i set = _mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), laneBits);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(set, laneBits));
+}
+
+// (x + (x - prev) * damping) + force * scale with separate multiply and add at every level, the
+// association of the scalar path - forcing a lower level has to give the same bits
+CLOTH_TARGET("sse4.2")
+inline void integrateAxisSSE(float* pos, float* prev, const float* force, __m128 scale, __m128 damping, __m128 mask) {
+    __m128 x = _mm_load_ps(pos);
+    __m128 px = _mm_load_ps(prev);
+    __m128 nx = _mm_add_ps(_mm_add_ps(x, _mm_mul_ps(_mm_sub_ps(x, px), damping)), _mm_mul_ps(_mm_load_ps(force), scale));
+    _mm_store_ps(pos, _mm_blendv_ps(x, nx, mask));
+    _mm_store_ps(prev, _mm_blendv_ps(px, x, mask));
+}
+
+CLOTH_TARGET("sse4.2")
+void applyGravitySSE42(ParticleStore& p, float gravity) {
+    const __m128 vGravity = _mm_set1_ps(gravity);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (std::size_t i = 0; i < p.size(); i += 4) {
+        unsigned bits = freeLanes(p, i, 4);
+        if (bits == 0) continue;
+
+        __m128 mask = laneMaskSSE(bits);
+        __m128 fy = _mm_div_ps(vGravity, _mm_load_ps(&p.invMass[i]));
+        _mm_store_ps(&p.forceX[i], _mm_blendv_ps(_mm_load_ps(&p.forceX[i]), zero, mask));
+        _mm_store_ps(&p.forceY[i], _mm_blendv_ps(_mm_load_ps(&p.forceY[i]), fy, mask));
+        _mm_store_ps(&p.forceZ[i], _mm_blendv_ps(_mm_load_ps(&p.forceZ[i]), zero, mask));
+    }
+}
+
+CLOTH_TARGET("sse4.2")
+void integrateVerletSSE42(ParticleStore& p, float damping, float deltaTime) {
+    const __m128 vDamping = _mm_set1_ps(damping);
+    const __m128 vDt2 = _mm_set1_ps(deltaTime * deltaTime);
+
+    for (std::size_t i = 0; i < p.size(); i += 4) {
+        unsigned bits = freeLanes(p, i, 4);
+        if (bits == 0) continue;
+
+        __m128 mask = laneMaskSSE(bits);
+        __m128 scale = _mm_mul_ps(_mm_load_ps(&p.invMass[i]), vDt2);
+        integrateAxisSSE(&p.x[i], &p.prevX[i], &p.forceX[i], scale, vDamping, mask);
+        integrateAxisSSE(&p.y[i], &p.prevY[i], &p.forceY[i], scale, vDamping, mask);
+        integrateAxisSSE(&p.z[i], &p.prevZ[i], &p.forceZ[i], scale, vDamping, mask);
+    }
+}
+
+CLOTH_TARGET("sse4.2")
+inline __m128i mixSSE(__m128i x) {
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    x = _mm_mullo_epi32(x, _mm_set1_epi32(static_cast<int>(CounterRandom::MIX_MUL1)));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+    x = _mm_mullo_epi32(x, _mm_set1_epi32(static_cast<int>(CounterRandom::MIX_MUL2)));
+    return _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+}
+
+// base + signedUnit(bits(key, counter)) * amplitude, lane for lane
+CLOTH_TARGET("sse4.2")
+inline __m128 windAxisSSE(__m128i counter, uint32_t key, __m128 base, float amplitude) {
+    __m128i k = _mm_set1_epi32(static_cast<int>(key));
+    __m128i bits = mixSSE(_mm_add_epi32(mixSSE(_mm_xor_si128(counter, k)), k));
+    __m128 unit = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(bits, 8)), _mm_set1_ps(1.0f / 8388608.0f)),
+                             _mm_set1_ps(1.0f));
+    return _mm_add_ps(base, _mm_mul_ps(unit, _mm_set1_ps(amplitude)));
+}
+
+CLOTH_TARGET("sse4.2")
+void addTurbulenceSSE42(const WindTurbulence& t, float* velocityX, float* velocityY, float* velocityZ,
+                        std::size_t begin, std::size_t end) {
+    const __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3);
+
+    for (std::size_t i = begin; i < end; i += 4) {
+        __m128i counter = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(i)), laneIndex);
+        _mm_store_ps(&velocityX[i], windAxisSSE(counter, t.keyX, _mm_load_ps(&velocityX[i]), t.amplitudeX));
+        _mm_store_ps(&velocityY[i], windAxisSSE(counter, t.keyY, _mm_load_ps(&velocityY[i]), t.amplitudeY));
+        _mm_store_ps(&velocityZ[i], windAxisSSE(counter, t.keyZ, _mm_load_ps(&velocityZ[i]), t.amplitudeZ));
+    }
+}
+
+CLOTH_TARGET("sse4.2")
+void sampleWindSSE42(const GustField& g, const float* x, const float* y, const float* z,
+                     float* velocityX, float* velocityY, float* velocityZ, std::size_t count) {
+    const __m128 four = _mm_set1_ps(4.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (std::size_t i = 0; i < count; i += 4) {
+        __m128 px = _mm_load_ps(&x[i]);
+        __m128 py = _mm_load_ps(&y[i]);
+        __m128 pz = _mm_load_ps(&z[i]);
+        __m128 wx = _mm_set1_ps(g.baseX);
+        __m128 wy = _mm_set1_ps(g.baseY);
+        __m128 wz = _mm_set1_ps(g.baseZ);
+
+        for (int f = 0; f < g.frontCount; ++f) {
+            __m128 s = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(g.waveX[f])), _mm_mul_ps(py, _mm_set1_ps(g.waveY[f]))),
+                                  _mm_mul_ps(pz, _mm_set1_ps(g.waveZ[f])));
+            s = _mm_add_ps(s, _mm_set1_ps(g.phase[f]));
+            __m128 u = _mm_sub_ps(s, _mm_floor_ps(s));
+            __m128 pulse = _mm_mul_ps(_mm_mul_ps(four, u), _mm_sub_ps(one, u));
+            pulse = _mm_mul_ps(pulse, pulse);
+
+            wx = _mm_add_ps(wx, _mm_mul_ps(pulse, _mm_set1_ps(g.pushX[f])));
+            wy = _mm_add_ps(wy, _mm_mul_ps(pulse, _mm_set1_ps(g.pushY[f])));
+            wz = _mm_add_ps(wz, _mm_mul_ps(pulse, _mm_set1_ps(g.pushZ[f])));
+        }
+
+        _mm_store_ps(&velocityX[i], wx);
+        _mm_store_ps(&velocityY[i], wy);
+        _mm_store_ps(&velocityZ[i], wz);
+    }
+}
+
+// AVX2 - 8 particles per iteration
+
+CLOTH_TARGET("avx2,fma")
+inline __m256 laneMaskAVX2(unsigned bits) {
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i set = _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), laneBits);
+    return _mm256_castsi256_ps(_mm256_cmpeq_epi32(set, laneBits));
+}
+
+// no fmadd, see integrateAxisSSE
+CLOTH_TARGET("avx2,fma")
+inline void integrateAxisAVX2(float* pos, float* prev, const float* force, __m256 scale, __m256 damping, __m256 mask) {
+    __m256 x = _mm256_load_ps(pos);
+    __m256 px = _mm256_load_ps(prev);
+    __m256 nx = _mm256_add_ps(_mm256_add_ps(x, _mm256_mul_ps(_mm256_sub_ps(x, px), damping)),
+                              _mm256_mul_ps(_mm256_load_ps(force), scale));
+    _mm256_store_ps(pos, _mm256_blendv_ps(x, nx, mask));
+    _mm256_store_ps(prev, _mm256_blendv_ps(px, x, mask));
+}
+
+CLOTH_TARGET("avx2,fma")
+void applyGravityAVX2(ParticleStore& p, float gravity) {
+    const __m256 vGravity = _mm256_set1_ps(gravity);
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (std::size_t i = 0; i < p.size(); i += 8) {
+        unsigned bits = freeLanes(p, i, 8);
+        if (bits == 0) continue;
+
+        __m256 mask = laneMaskAVX2(bits);
+        __m256 fy = _mm256_div_ps(vGravity, _mm256_load_ps(&p.invMass[i]));
+        _mm256_store_ps(&p.forceX[i], _mm256_blendv_ps(_mm256_load_ps(&p.forceX[i]), zero, mask));
+        _mm256_store_ps(&p.forceY[i], _mm256_blendv_ps(_mm256_load_ps(&p.forceY[i]), fy, mask));
+        _mm256_store_ps(&p.forceZ[i], _mm256_blendv_ps(_mm256_load_ps(&p.forceZ[i]), zero, mask));
+    }
+}
+
+CLOTH_TARGET("avx2,fma")
+void integrateVerletAVX2(ParticleStore& p, float damping, float deltaTime) {
+    const __m256 vDamping = _mm256_set1_ps(damping);
+    const __m256 vDt2 = _mm256_set1_ps(deltaTime * deltaTime);
+
+    for (std::size_t i = 0; i < p.size(); i += 8) {
+        unsigned bits = freeLanes(p, i, 8);
+        if (bits == 0) continue;
+
+        __m256 mask = laneMaskAVX2(bits);
+        __m256 scale = _mm256_mul_ps(_mm256_load_ps(&p.invMass[i]), vDt2);
+        integrateAxisAVX2(&p.x[i], &p.prevX[i], &p.forceX[i], scale, vDamping, mask);
+        integrateAxisAVX2(&p.y[i], &p.prevY[i], &p.forceY[i], scale, vDamping, mask);
+        integrateAxisAVX2(&p.z[i], &p.prevZ[i], &p.forceZ[i], scale, vDamping, mask);
+    }
+}
+
+CLOTH_TARGET("avx2,fma")
+inline __m256i mixAVX2(__m256i x) {
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(CounterRandom::MIX_MUL1)));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(CounterRandom::MIX_MUL2)));
+    return _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+}
+
+// separate multiply and add, not fmadd - the turbulence has to match the scalar path bit for bit
+CLOTH_TARGET("avx2,fma")
+inline __m256 windAxisAVX2(__m256i counter, uint32_t key, __m256 base, float amplitude) {
+    __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+    __m256i bits = mixAVX2(_mm256_add_epi32(mixAVX2(_mm256_xor_si256(counter, k)), k));
+    __m256 unit = _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(bits, 8)), _mm256_set1_ps(1.0f / 8388608.0f)),
+                                _mm256_set1_ps(1.0f));
+    return _mm256_add_ps(base, _mm256_mul_ps(unit, _mm256_set1_ps(amplitude)));
+}
+
+CLOTH_TARGET("avx2,fma")
+void addTurbulenceAVX2(const WindTurbulence& t, float* velocityX, float* velocityY, float* velocityZ,
+                       std::size_t begin, std::size_t end) {
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (std::size_t i = begin; i < end; i += 8) {
+        __m256i counter = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), laneIndex);
+        _mm256_store_ps(&velocityX[i], windAxisAVX2(counter, t.keyX, _mm256_load_ps(&velocityX[i]), t.amplitudeX));
+        _mm256_store_ps(&velocityY[i], windAxisAVX2(counter, t.keyY, _mm256_load_ps(&velocityY[i]), t.amplitudeY));
+        _mm256_store_ps(&velocityZ[i], windAxisAVX2(counter, t.keyZ, _mm256_load_ps(&velocityZ[i]), t.amplitudeZ));
+    }
+}
+
+CLOTH_TARGET("avx2,fma")
+void sampleWindAVX2(const GustField& g, const float* x, const float* y, const float* z,
+                    float* velocityX, float* velocityY, float* velocityZ, std::size_t count) {
+    const __m256 four = _mm256_set1_ps(4.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    for (std::size_t i = 0; i < count; i += 8) {
+        __m256 px = _mm256_load_ps(&x[i]);
+        __m256 py = _mm256_load_ps(&y[i]);
+        __m256 pz = _mm256_load_ps(&z[i]);
+        __m256 wx = _mm256_set1_ps(g.baseX);
+        __m256 wy = _mm256_set1_ps(g.baseY);
+        __m256 wz = _mm256_set1_ps(g.baseZ);
+
+        for (int f = 0; f < g.frontCount; ++f) {
+            __m256 s = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(g.waveX[f])),
+                                                   _mm256_mul_ps(py, _mm256_set1_ps(g.waveY[f]))),
+                                     _mm256_mul_ps(pz, _mm256_set1_ps(g.waveZ[f])));
+            s = _mm256_add_ps(s, _mm256_set1_ps(g.phase[f]));
+            __m256 u = _mm256_sub_ps(s, _mm256_floor_ps(s));
+            __m256 pulse = _mm256_mul_ps(_mm256_mul_ps(four, u), _mm256_sub_ps(one, u));
+            pulse = _mm256_mul_ps(pulse, pulse);
+
+            wx = _mm256_add_ps(wx, _mm256_mul_ps(pulse, _mm256_set1_ps(g.pushX[f])));
+            wy = _mm256_add_ps(wy, _mm256_mul_ps(pulse, _mm256_set1_ps(g.pushY[f])));
+            wz = _mm256_add_ps(wz, _mm256_mul_ps(pulse, _mm256_set1_ps(g.pushZ[f])));
+        }
+
+        _mm256_store_ps(&velocityX[i], wx);
+        _mm256_store_ps(&velocityY[i], wy);
+        _mm256_store_ps(&velocityZ[i], wz);
+    }
+}
+
+// AVX-512 - 16 particles per iteration, flag bits map straight onto a lane mask
+
+// no fmadd, see integrateAxisSSE
+CLOTH_TARGET("avx512f")
+inline void integrateAxisAVX512(float* pos, float* prev, const float* force, __m512 scale, __m512 damping, __mmask16 mask) {
+    __m512 x = _mm512_load_ps(pos);
+    __m512 px = _mm512_load_ps(prev);
+    __m512 nx = _mm512_add_ps(_mm512_add_ps(x, _mm512_mul_ps(_mm512_sub_ps(x, px), damping)),
+                              _mm512_mul_ps(_mm512_load_ps(force), scale));
+    _mm512_mask_store_ps(pos, mask, nx);
+    _mm512_mask_store_ps(prev, mask, x);
+}
+
+CLOTH_TARGET("avx512f")
+void applyGravityAVX512(ParticleStore& p, float gravity) {
+    const __m512 vGravity = _mm512_set1_ps(gravity);
+    const __m512 zero = _mm512_setzero_ps();
+
+    for (std::size_t i = 0; i < p.size(); i += 16) {
+        __mmask16 mask = static_cast<__mmask16>(freeLanes(p, i, 16));
+        if (mask == 0) continue;
+
+        _mm512_mask_store_ps(&p.forceX[i], mask, zero);
+        _mm512_mask_store_ps(&p.forceY[i], mask, _mm512_div_ps(vGravity, _mm512_load_ps(&p.invMass[i])));
+        _mm512_mask_store_ps(&p.forceZ[i], mask, zero);
+    }
+}
+
+CLOTH_TARGET("avx512f")
+void integrateVerletAVX512(ParticleStore& p, float damping, float deltaTime) {
+    const __m512 vDamping = _mm512_set1_ps(damping);
+    const __m512 vDt2 = _mm512_set1_ps(deltaTime * deltaTime);
+
+    for (std::size_t i = 0; i < p.size(); i += 16) {
+        __mmask16 mask = static_cast<__mmask16>(freeLanes(p, i, 16));
+        if (mask == 0) continue;
+
+        __m512 scale = _mm512_mul_ps(_mm512_load_ps(&p.invMass[i]), vDt2);
+        integrateAxisAVX512(&p.x[i], &p.prevX[i], &p.forceX[i], scale, vDamping, mask);
+        integrateAxisAVX512(&p.y[i], &p.prevY[i], &p.forceY[i], scale, vDamping, mask);
+        integrateAxisAVX512(&p.z[i], &p.prevZ[i], &p.forceZ[i], scale, vDamping, mask);
+    }
+}
+
+// GCC 12 reports -Wmaybe-uninitialized on the self-initialized placeholder _mm512_srli_epi32
+// and _mm512_cvtepi32_ps pass as their unused merge source
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+CLOTH_TARGET("avx512f")
+inline __m512i mixAVX512(__m512i x) {
+    x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+    x = _mm512_mullo_epi32(x, _mm512_set1_epi32(static_cast<int>(CounterRandom::MIX_MUL1)));
+    x = _mm512_xor_si512(x, _mm512_srli_epi32(x, 15));
+    x = _mm512_mullo_epi32(x, _mm512_set1_epi32(static_cast<int>(CounterRandom::MIX_MUL2)));
+    return _mm512_xor_si512(x, _mm512_srli_epi32(x, 16));
+}
+
+CLOTH_TARGET("avx512f")
+inline __m512 windAxisAVX512(__m512i counter, uint32_t key, __m512 base, float amplitude) {
+    __m512i k = _mm512_set1_epi32(static_cast<int>(key));
+    __m512i bits = mixAVX512(_mm512_add_epi32(mixAVX512(_mm512_xor_si512(counter, k)), k));
+    __m512 unit = _mm512_sub_ps(_mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(bits, 8)), _mm512_set1_ps(1.0f / 8388608.0f)),
+                                _mm512_set1_ps(1.0f));
+    return _mm512_add_ps(base, _mm512_mul_ps(unit, _mm512_set1_ps(amplitude)));
+}
+
+CLOTH_TARGET("avx512f")
+void addTurbulenceAVX512(const WindTurbulence& t, float* velocityX, float* velocityY, float* velocityZ,
+                         std::size_t begin, std::size_t end) {
+    const __m512i laneIndex = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    for (std::size_t i = begin; i < end; i += 16) {
+        __m512i counter = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(i)), laneIndex);
+        _mm512_store_ps(&velocityX[i], windAxisAVX512(counter, t.keyX, _mm512_load_ps(&velocityX[i]), t.amplitudeX));
+        _mm512_store_ps(&velocityY[i], windAxisAVX512(counter, t.keyY, _mm512_load_ps(&velocityY[i]), t.amplitudeY));
+        _mm512_store_ps(&velocityZ[i], windAxisAVX512(counter, t.keyZ, _mm512_load_ps(&velocityZ[i]), t.amplitudeZ));
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+CLOTH_TARGET("avx512f")
+void sampleWindAVX512(const GustField& g, const float* x, const float* y, const float* z,
+                      float* velocityX, float* velocityY, float* velocityZ, std::size_t count) {
+    const __m512 four = _mm512_set1_ps(4.0f);
+    const __m512 one = _mm512_set1_ps(1.0f);
+
+    for (std::size_t i = 0; i < count; i += 16) {
+        __m512 px = _mm512_load_ps(&x[i]);
+        __m512 py = _mm512_load_ps(&y[i]);
+        __m512 pz = _mm512_load_ps(&z[i]);
+        __m512 wx = _mm512_set1_ps(g.baseX);
+        __m512 wy = _mm512_set1_ps(g.baseY);
+        __m512 wz = _mm512_set1_ps(g.baseZ);
+
+        for (int f = 0; f < g.frontCount; ++f) {
+            __m512 s = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(px, _mm512_set1_ps(g.waveX[f])),
+                                                   _mm512_mul_ps(py, _mm512_set1_ps(g.waveY[f]))),
+                                     _mm512_mul_ps(pz, _mm512_set1_ps(g.waveZ[f])));
+            s = _mm512_add_ps(s, _mm512_set1_ps(g.phase[f]));
+            __m512 u = _mm512_sub_ps(s, _mm512_floor_ps(s));
+            __m512 pulse = _mm512_mul_ps(_mm512_mul_ps(four, u), _mm512_sub_ps(one, u));
+            pulse = _mm512_mul_ps(pulse, pulse);
+
+            wx = _mm512_add_ps(wx, _mm512_mul_ps(pulse, _mm512_set1_ps(g.pushX[f])));
+            wy = _mm512_add_ps(wy, _mm512_mul_ps(pulse, _mm512_set1_ps(g.pushY[f])));
+            wz = _mm512_add_ps(wz, _mm512_mul_ps(pulse, _mm512_set1_ps(g.pushZ[f])));
+        }
+
+        _mm512_store_ps(&velocityX[i], wx);
+        _mm512_store_ps(&velocityY[i], wy);
+        _mm512_store_ps(&velocityZ[i], wz);
+    }
+}
+
+#endif // CLOTH_SIMD_X86
+
+SimdLevel cpuLevel() {
+#ifdef CLOTH_SIMD_X86
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SimdLevel::SSE42;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse42 = (info[2] & (1 << 20)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    // the OS has to save the wide registers on context switch
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool ymmState = (xcr0 & 0x6) == 0x6;
+    bool zmmState = (xcr0 & 0xe6) == 0xe6;
+
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        if (zmmState && (info[1] & (1 << 16))) return SimdLevel::AVX512;
+        if (ymmState && fma && (info[1] & (1 << 5))) return SimdLevel::AVX2;
+    }
+    if (sse42) return SimdLevel::SSE42;
+#endif
+#endif
+    return SimdLevel::SCALAR;
+}
+
+// CLOTH_SIMD can only lower the level, never enable something the CPU lacks
+SimdLevel overrideLevel(SimdLevel detected) {
+    const char* env = std::getenv("CLOTH_SIMD");
+    if (!env) return detected;
+
+    SimdLevel requested = detected;
+    if (std::strcmp(env, "scalar") == 0)        requested = SimdLevel::SCALAR;
+    else if (std::strcmp(env, "sse4.2") == 0)   requested = SimdLevel::SSE42;
+    else if (std::strcmp(env, "avx2") == 0)     requested = SimdLevel::AVX2;
+    else if (std::strcmp(env, "avx512") == 0)   requested = SimdLevel::AVX512;
+
+    return requested < detected ? requested : detected;
+}
+
+} // namespace
+
+const ParticleKernels& ParticleKernels::forLevel(SimdLevel level) {
+    static const ParticleKernels scalar = { SimdLevel::SCALAR, applyGravityScalar, integrateVerletScalar,
+                                            sampleWindScalar, addTurbulenceScalar };
+#ifdef CLOTH_SIMD_X86
+    static const ParticleKernels sse42  = { SimdLevel::SSE42, applyGravitySSE42, integrateVerletSSE42,
+                                            sampleWindSSE42, addTurbulenceSSE42 };
+    static const ParticleKernels avx2   = { SimdLevel::AVX2, applyGravityAVX2, integrateVerletAVX2,
+                                            sampleWindAVX2, addTurbulenceAVX2 };
+    static const ParticleKernels avx512 = { SimdLevel::AVX512, applyGravityAVX512, integrateVerletAVX512,
+                                            sampleWindAVX512, addTurbulenceAVX512 };
+
+    switch (level) {
+        case SimdLevel::AVX512: return avx512;
+        case SimdLevel::AVX2:   return avx2;
+        case SimdLevel::SSE42:  return sse42;
+        case SimdLevel::SCALAR: break;
+    }
+#else
+    (void)level;
+#endif
+    return scalar;
+}
+
+const ParticleKernels& ParticleKernels::get() {
+    static const ParticleKernels& selected = forLevel(detectLevel());
+    return selected;
+}
+
+SimdLevel ParticleKernels::detectLevel() {
+    return overrideLevel(cpuLevel());
+}
+
+const char* ParticleKernels::levelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::AVX2:   return "AVX2";
+        case SimdLevel::SSE42:  return "SSE4.2";
+        case SimdLevel::SCALAR: break;
+    }
+    return "Scalar";
+}
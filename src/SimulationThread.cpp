@@ -0,0 +1,141 @@
+#include "SimulationThread.h"
+
+#include <chrono>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+}
+
+SimulationThread::SimulationThread(std::unique_ptr<ClothSystem> cloth) : cloth(std::move(cloth)) {
+    // so the first acquire() already has something to draw
+    publish();
+}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::start() {
+    if (running.exchange(true)) return;
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    running.store(false, std::memory_order_release);
+    if (thread.joinable()) thread.join();
+}
+
+void SimulationThread::submit(Command command) {
+    // a full queue only means the simulation is mid step, it drains the queue before the next
+    while (!commands.push(std::move(command))) {
+        std::this_thread::yield();
+    }
+}
+
+const ClothSnapshot& SimulationThread::acquire() {
+    snapshots.consume();
+    return snapshots.readSlot();
+}
+
+void SimulationThread::run() {
+    Clock::time_point lastTime = Clock::now();
+    
+    while (running.load(std::memory_order_acquire)) {
+        Command command;
+        while (commands.pop(command)) {
+            command(*cloth);
+        }
+        
+        Clock::time_point now = Clock::now();
+        float deltaTime = std::chrono::duration<float>(now - lastTime).count();
+        lastTime = now;
+        
+        // the cloth's step scheduler bounds how much of a long gap gets simulated
+        if (!paused.load(std::memory_order_relaxed)) {
+            cloth->update(deltaTime);
+        }
+        
+        publish();
+        
+        // about one fixed step per iteration, no sleep at all once a step takes longer than that
+        // the render thread interpolates in between
+        std::this_thread::sleep_until(now + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<float>(cloth->getFixedTimeStep())));
+    }
+}
+
+void SimulationThread::publish() {
+    ClothSnapshot& snapshot = snapshots.writeSlot();
+    
+    writeStreams(snapshot);
+    snapshot.atRest = cloth->isAtRest();
+    
+    if (snapshot.topologyVersion != cloth->getTopologyVersion()) {
+        snapshot.texCoords = cloth->getTexCoords();
+        snapshot.indices = cloth->getIndices();
+        snapshot.topologyVersion = cloth->getTopologyVersion();
+    }
+    
+    snapshot.spheres = cloth->getSpheres();
+    snapshot.previousSphereCenters = cloth->getPreviousSphereCenters();
+    snapshot.activeParticles = cloth->getActiveParticleCount();
+    snapshot.sleepingTiles = cloth->getSleepingTileCount();
+    snapshot.tileCount = cloth->getTileCount();
+    snapshot.islandCount = cloth->getIslandCount();
+    snapshot.sleepingIslands = cloth->getSleepingIslandCount();
+    
+    snapshot.alpha = cloth->getInterpolationAlpha();
+    snapshot.fixedTimeStep = cloth->getFixedTimeStep();
+    snapshot.publishTime = ClothSnapshot::Clock::now();
+    snapshot.advancing = running.load(std::memory_order_relaxed) && !paused.load(std::memory_order_relaxed);
+    
+    snapshot.gravity = cloth->getGravity();
+    snapshot.damping = cloth->getDamping();
+    snapshot.windStrength = cloth->getWindStrength();
+    snapshot.windDirection = cloth->getWindDirection();
+    snapshot.windGustiness = cloth->getWindGustiness();
+    snapshot.tearThreshold = cloth->getTearThreshold();
+    snapshot.solverMode = cloth->getSolverMode();
+    snapshot.substeps = cloth->getSubsteps();
+    snapshot.solverIterations = cloth->getSolverIterations();
+    snapshot.maxStepsPerFrame = cloth->getMaxStepsPerFrame();
+    snapshot.overrunPolicy = cloth->getOverrunPolicy();
+    snapshot.skippedSteps = cloth->getSkippedSteps();
+    snapshot.physicsRate = 1.0f / cloth->getFixedTimeStep();
+    
+    snapshots.publish();
+}
+
+void SimulationThread::writeStreams(ClothSnapshot& snapshot) {
+    size_t vertexCount = cloth->getVertexCount();
+    uint64_t renderVersion = cloth->getRenderVersion();
+    uint64_t topologyVersion = cloth->getTopologyVersion();
+    snapshot.vertexCount = vertexCount;
+    
+    // a sleeping cloth points at the region written last, the render thread still has it
+    bool unchanged = ringRenderVersion == renderVersion && ringTopologyVersion == topologyVersion;
+    if (ringSequence == 0 || !unchanged) {
+        ringSequence = vertexRing.nextSequence(vertexCount);
+        
+        if (ringSequence != 0) {
+            VertexRing::Region region = vertexRing.region(ringSequence);
+            cloth->writeVertices(region.positions, region.normals);
+            cloth->writePreviousPositions(region.previousPositions);
+            vertexRing.written(ringSequence);
+            ringRenderVersion = renderVersion;
+            ringTopologyVersion = topologyVersion;
+        }
+    }
+    snapshot.vertexSequence = ringSequence;
+    if (ringSequence != 0) return;
+    
+    // no region - copied into the slot, which a sleeping cloth leaves as it is
+    if (snapshot.renderVersion != renderVersion || snapshot.topologyVersion != topologyVersion) {
+        snapshot.positions.resize(vertexCount * 3);
+        snapshot.previousPositions.resize(vertexCount * 3);
+        snapshot.normals.resize(vertexCount * 3);
+        cloth->writeVertices(snapshot.positions.data(), snapshot.normals.data());
+        cloth->writePreviousPositions(snapshot.previousPositions.data());
+        snapshot.renderVersion = renderVersion;
+    }
+}
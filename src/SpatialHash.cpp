@@ -0,0 +1,31 @@
+#include "SpatialHash.h"
+
+void SpatialHash::build(const ParticleStore& particles, float cellSize) {
+    invCellSize = 1.0f / cellSize;
+
+    // power of two table with about two buckets per particle
+    uint32_t tableSize = 64;
+    while (tableSize < 2 * particles.size()) tableSize <<= 1;
+    tableMask = tableSize - 1;
+
+    // counting sort of active particles by bucket
+    std::vector<uint32_t> buckets(particles.size());
+    cellStart.assign(tableSize + 1, 0);
+
+    for (size_t i = 0; i < particles.size(); ++i) {
+        if (!particles.isActive(i)) continue;
+
+        buckets[i] = bucketOf(cellCoord(particles.x[i]), cellCoord(particles.y[i]), cellCoord(particles.z[i]));
+        cellStart[buckets[i] + 1]++;
+    }
+    for (uint32_t b = 0; b < tableSize; ++b) {
+        cellStart[b + 1] += cellStart[b];
+    }
+
+    entries.assign(cellStart[tableSize], -1);
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < particles.size(); ++i) {
+        if (!particles.isActive(i)) continue;
+        entries[fill[buckets[i]]++] = static_cast<int>(i);
+    }
+}
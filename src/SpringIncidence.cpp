@@ -0,0 +1,47 @@
+#include "SpringIncidence.h"
+#include "ClothSystem.h"
+
+void SpringIncidence::build(size_t particleCount, const std::vector<Spring>& springs) {
+    offsets.assign(particleCount + 1, 0);
+    liveCounts.assign(particleCount, 0);
+
+    // count degrees, prefix sum into row starts
+    for (const auto& spring : springs) {
+        if (!spring.active) continue;
+        offsets[spring.particle1 + 1]++;
+        offsets[spring.particle2 + 1]++;
+    }
+    for (size_t i = 0; i < particleCount; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    springIds.assign(offsets[particleCount], -1);
+    for (size_t i = 0; i < springs.size(); ++i) {
+        const Spring& spring = springs[i];
+        if (!spring.active) continue;
+
+        int index = static_cast<int>(i);
+        springIds[offsets[spring.particle1] + liveCounts[spring.particle1]++] = index;
+        springIds[offsets[spring.particle2] + liveCounts[spring.particle2]++] = index;
+    }
+}
+
+void SpringIncidence::remove(int spring, int particle1, int particle2) {
+    removeFromRow(particle1, spring);
+    removeFromRow(particle2, spring);
+}
+
+void SpringIncidence::removeFromRow(int particle, int spring) {
+    int* row = springIds.data() + offsets[particle];
+    int& count = liveCounts[particle];
+
+    for (int i = 0; i < count; ++i) {
+        if (row[i] == spring) {
+            // swap with the last live entry, dead entries stay behind the live ones
+            row[i] = row[count - 1];
+            row[count - 1] = spring;
+            --count;
+            return;
+        }
+    }
+}
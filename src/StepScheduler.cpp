@@ -0,0 +1,57 @@
+#include "StepScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+StepScheduler::StepScheduler(float fixedTimeStep) : fixedTimeStep(fixedTimeStep) {}
+
+void StepScheduler::beginFrame(float deltaTime) {
+    // a stalled clock or garbage from the caller must not poison the accumulator
+    if (!(deltaTime > 0.0f)) deltaTime = 0.0f;
+    
+    accumulator += deltaTime;
+    frameStart = Clock::now();
+    frameSteps = 0;
+}
+
+bool StepScheduler::nextStep() {
+    if (accumulator < fixedTimeStep) return false;
+    if (frameSteps >= maxStepsPerFrame) return false;
+    
+    // the first step always runs so the simulation never stalls completely
+    if (frameSteps > 0 && std::chrono::duration<double>(Clock::now() - frameStart).count() >= budget) {
+        return false;
+    }
+    
+    accumulator -= fixedTimeStep;
+    frameSteps++;
+    return true;
+}
+
+void StepScheduler::endFrame() {
+    lastSkipped = 0;
+    
+    // whole steps still owed, the fraction below one step always carries over
+    float owed = std::floor(accumulator / fixedTimeStep);
+    if (owed < 1.0f) return;
+    
+    float kept = 0.0f;
+    if (policy == OverrunPolicy::SLOW) {
+        kept = std::min(owed, static_cast<float>(maxStepsPerFrame));
+    }
+    
+    lastSkipped = static_cast<int>(owed - kept);
+    accumulator -= lastSkipped * fixedTimeStep;
+    skippedSteps += lastSkipped;
+}
+
+void StepScheduler::reset() {
+    accumulator = 0.0f;
+    frameSteps = 0;
+    lastSkipped = 0;
+    skippedSteps = 0;
+}
+
+void StepScheduler::setMaxStepsPerFrame(int count) {
+    maxStepsPerFrame = std::max(count, 1);
+}
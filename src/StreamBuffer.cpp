@@ -0,0 +1,88 @@
+#include "StreamBuffer.h"
+
+StreamBuffer::StreamBuffer(size_t vertexSize) : vertexSize(vertexSize) {}
+
+StreamBuffer::~StreamBuffer() {
+    release();
+}
+
+void StreamBuffer::release() {
+    for (GLsync& sync : fences) {
+        if (sync) glDeleteSync(sync);
+        sync = nullptr;
+    }
+    
+    // deleting a buffer unmaps it
+    if (buffer) glDeleteBuffers(1, &buffer);
+    
+    buffer = 0;
+    mapped = nullptr;
+    capacity = 0;
+    region = REGIONS - 1;
+    staging.clear();
+}
+
+void StreamBuffer::reserve(size_t vertexCount) {
+    if (buffer && vertexCount <= capacity) return;
+    
+    release();
+    capacity = vertexCount > 0 ? vertexCount : 1;
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(REGIONS * capacity * vertexSize);
+    
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    
+    persistent = GLEW_ARB_buffer_storage;
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+        mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+        
+        // immutable storage cannot be respecified, start over with a plain buffer
+        if (!mapped) {
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            persistent = false;
+        }
+    }
+    
+    if (!persistent) {
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        staging.resize(capacity * vertexSize);
+    }
+}
+
+void* StreamBuffer::map() {
+    region = (region + 1) % REGIONS;
+    
+    if (!persistent) return staging.data();
+    
+    // placed two frames ago, normally long signalled
+    if (GLsync sync = fences[region]) {
+        GLenum status = glClientWaitSync(sync, 0, 0);
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(sync);
+        fences[region] = nullptr;
+    }
+    
+    return static_cast<unsigned char*>(mapped) + offset();
+}
+
+void StreamBuffer::unmap(size_t vertexCount) {
+    // coherent mapping, writes are visible to commands issued from here on
+    if (persistent) return;
+    
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(offset()),
+                    static_cast<GLsizeiptr>(vertexCount * vertexSize), staging.data());
+}
+
+void StreamBuffer::fence() {
+    if (!persistent) return;
+    
+    if (fences[region]) glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,162 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+// > 0 while this thread is executing a loop body
+thread_local int loopDepth = 0;
+
+uint64_t packRange(size_t begin, size_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | static_cast<uint32_t>(end);
+}
+
+size_t rangeBegin(uint64_t packed) { return static_cast<size_t>(packed >> 32); }
+size_t rangeEnd(uint64_t packed) { return static_cast<size_t>(packed & 0xffffffffu); }
+}
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    threadCount = std::max<size_t>(threadCount, 1);
+    ranges = std::make_unique<ChunkRange[]>(threadCount);
+
+    for (size_t i = 0; i + 1 < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const RangeFunction& body) {
+    if (count == 0) return;
+    grainSize = std::max<size_t>(grainSize, 1);
+
+    // small loops, single-threaded pools and nested loops run inline
+    if (workers.empty() || count <= grainSize || loopDepth > 0) {
+        ++loopDepth;
+        body(0, count);
+        --loopDepth;
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(submitMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        jobCount = count;
+        jobGrain = grainSize;
+
+        // even contiguous shares, late or busy participants simply get theirs stolen
+        size_t chunks = (count + grainSize - 1) / grainSize;
+        size_t participants = size();
+        for (size_t slot = 0; slot < participants; ++slot) {
+            ranges[slot].packed.store(packRange(chunks * slot / participants, chunks * (slot + 1) / participants),
+                                      std::memory_order_relaxed);
+        }
+        ++generation;
+    }
+    wake.notify_all();
+
+    runChunks(0);
+
+    // workers that picked up the loop have to drain before the body goes out of scope
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::runChunks(size_t slot) {
+    ++loopDepth;
+
+    size_t chunk;
+    for (;;) {
+        if (!takeChunk(slot, chunk)) {
+            // every chunk is taken once all shares are seen empty
+            if (!stealChunks(slot)) break;
+            continue;
+        }
+
+        size_t begin = chunk * jobGrain;
+        size_t end = std::min(begin + jobGrain, jobCount);
+        (*job)(begin, end);
+    }
+
+    --loopDepth;
+}
+
+bool ThreadPool::takeChunk(size_t slot, size_t& chunk) {
+    std::atomic<uint64_t>& own = ranges[slot].packed;
+    uint64_t packed = own.load(std::memory_order_acquire);
+
+    for (;;) {
+        size_t begin = rangeBegin(packed);
+        size_t end = rangeEnd(packed);
+        if (begin >= end) return false;
+
+        if (own.compare_exchange_weak(packed, packRange(begin + 1, end), std::memory_order_acq_rel)) {
+            chunk = begin;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::stealChunks(size_t slot) {
+    size_t participants = size();
+
+    for (size_t offset = 1; offset < participants; ++offset) {
+        std::atomic<uint64_t>& victim = ranges[(slot + offset) % participants].packed;
+        uint64_t packed = victim.load(std::memory_order_acquire);
+
+        for (;;) {
+            size_t begin = rangeBegin(packed);
+            size_t end = rangeEnd(packed);
+            if (begin >= end) break;
+
+            // the back half, or the last chunk
+            size_t middle = begin + (end - begin) / 2;
+            if (victim.compare_exchange_weak(packed, packRange(begin, middle), std::memory_order_acq_rel)) {
+                // our share is empty, so nobody else touches it until we publish the stolen chunks
+                ranges[slot].packed.store(packRange(middle, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t slot) {
+    uint64_t seenGeneration = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+
+            seenGeneration = generation;
+            if (!job) continue;     // loop already completed by the others
+            ++busyWorkers;
+        }
+
+        runChunks(slot);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busyWorkers;
+        }
+        finished.notify_one();
+    }
+}
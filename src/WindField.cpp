@@ -0,0 +1,98 @@
+#include "WindField.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// gust fronts in the wind's own frame - along the base direction, across it horizontally, and up
+struct FrontShape {
+    float travelAngle;      // radians from downwind towards across
+    float wavelength;       // distance between two gusts of this front
+    float speed;            // relative to the wind speed
+    float along, across, up;
+    float phase;
+};
+
+const FrontShape FRONTS[] = {
+    {  0.0f, 7.0f, 0.8f, 0.6f, 0.0f,  0.1f,  0.0f  },     // broad gusts rolling downwind
+    {  0.6f, 4.3f, 0.7f, 0.3f, 0.15f, 0.05f, 0.37f },     // oblique gusts
+    { -0.9f, 2.9f, 0.9f, 0.0f, 0.2f,  0.15f, 0.71f },     // crosswind flutter
+};
+constexpr int FRONT_COUNT = sizeof(FRONTS) / sizeof(FRONTS[0]);
+static_assert(FRONT_COUNT <= GustField::MAX_FRONTS, "too many gust fronts");
+
+// mean of (4u(1 - u))^2 over a cycle
+constexpr float MEAN_PULSE = 8.0f / 15.0f;
+
+} // namespace
+
+WindField::WindField() : kernels(&ParticleKernels::get()) {
+    reset();
+}
+
+void WindField::setBase(const glm::vec3& windDirection, float windStrength) {
+    direction = windDirection;
+    strength = windStrength;
+    rebuild();
+}
+
+void WindField::setGustiness(float amount) {
+    gustiness = std::max(amount, 0.0f);
+    rebuild();
+}
+
+void WindField::advance(float deltaTime) {
+    // fronts travel at a fraction of the wind speed, a stronger wind brings gusts in faster
+    for (int f = 0; f < FRONT_COUNT; ++f) {
+        float cycles = frontPhase[f] - strength * FRONTS[f].speed * deltaTime / FRONTS[f].wavelength;
+        frontPhase[f] = cycles - std::floor(cycles);
+    }
+    rebuild();
+}
+
+void WindField::reset() {
+    for (int f = 0; f < FRONT_COUNT; ++f) {
+        frontPhase[f] = FRONTS[f].phase;
+    }
+    rebuild();
+}
+
+void WindField::sample(const float* x, const float* y, const float* z,
+                       float* velocityX, float* velocityY, float* velocityZ, size_t count) const {
+    kernels->sampleWind(field, x, y, z, velocityX, velocityY, velocityZ, count);
+}
+
+void WindField::rebuild() {
+    glm::vec3 along = glm::length(direction) > 0.0f ? glm::normalize(direction) : glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 across = glm::cross(along, glm::vec3(0.0f, 1.0f, 0.0f));
+    across = glm::length(across) > 1e-4f ? glm::normalize(across) : glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 up = glm::cross(across, along);
+
+    // gusts redistribute the wind rather than add to it - the base gives up their mean push
+    float meanGust = 0.0f;
+    for (int f = 0; f < FRONT_COUNT; ++f) {
+        meanGust += FRONTS[f].along * MEAN_PULSE;
+    }
+    glm::vec3 base = along * strength * (1.0f - gustiness * meanGust);
+
+    field.frontCount = gustiness > 0.0f && strength > 0.0f ? FRONT_COUNT : 0;
+    field.baseX = base.x;
+    field.baseY = base.y;
+    field.baseZ = base.z;
+
+    for (int f = 0; f < field.frontCount; ++f) {
+        const FrontShape& shape = FRONTS[f];
+        glm::vec3 travel = along * std::cos(shape.travelAngle) + across * std::sin(shape.travelAngle);
+        glm::vec3 wave = travel / shape.wavelength;
+        glm::vec3 push = (along * shape.along + across * shape.across + up * shape.up) * strength * gustiness;
+
+        field.waveX[f] = wave.x;
+        field.waveY[f] = wave.y;
+        field.waveZ[f] = wave.z;
+        field.phase[f] = frontPhase[f];
+        field.pushX[f] = push.x;
+        field.pushY[f] = push.y;
+        field.pushZ[f] = push.z;
+    }
+}
@@ -0,0 +1,276 @@
+#include "ClothSystem.h"
+#include "ClothWorld.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// steps a cloth without a window and reports where the time went
+// usage: cloth_headless [--width N] [--height N] [--frames N] [--dt seconds]
+//                       [--mode tear|collision|flag] [--solver pbd|xpbd]
+//                       [--substeps N] [--iterations N]
+//                       [--max-steps N] [--budget ms] [--overrun drop|slow] [--rate hz]
+//                       [--cloths N] [--seed N] [--sleep on|off] [--layout rows|tiles]
+//                       [--blocking on|off] [--validate on|off]
+
+namespace {
+
+struct Options {
+    int width = 128;
+    int height = 128;
+    int frames = 600;
+    float deltaTime = 1.0f / 60.0f;
+    SimulationMode mode = SimulationMode::COLLISION;
+    SolverMode solver = SolverMode::PBD;
+    int substeps = 0;           // 0 = solver default
+    int iterations = 0;
+    int maxSteps = 0;           // 0 = scheduler default
+    double budgetMs = 0.0;
+    OverrunPolicy overrun = OverrunPolicy::DROP;
+    float rate = 0.0f;          // fixed steps per second, 0 = default
+    int cloths = 1;             // side by side in one ClothWorld
+    long long seed = -1;        // wind turbulence, cloth i gets seed + i, -1 = random
+    bool sleep = true;          // settled tiles are skipped
+    ParticleLayout layout = ParticleLayout::ROWS;
+    bool blocking = true;       // large grids are solved block by block
+    bool validate = false;      // cut the cloths at random and check the islands every step
+};
+
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [--width N] [--height N] [--frames N] [--dt seconds]\n"
+              << "       [--mode tear|collision|flag] [--solver pbd|xpbd] [--substeps N] [--iterations N]\n"
+              << "       [--max-steps N] [--budget ms] [--overrun drop|slow] [--rate hz] [--cloths N]\n"
+              << "       [--seed N] [--sleep on|off] [--layout rows|tiles] [--blocking on|off]\n"
+              << "       [--validate on|off]\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            std::exit(0);
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << '\n';
+            return false;
+        }
+
+        std::string value = argv[++i];
+        if (arg == "--width")           options.width = std::atoi(value.c_str());
+        else if (arg == "--height")     options.height = std::atoi(value.c_str());
+        else if (arg == "--frames")     options.frames = std::atoi(value.c_str());
+        else if (arg == "--dt")         options.deltaTime = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--substeps")   options.substeps = std::atoi(value.c_str());
+        else if (arg == "--iterations") options.iterations = std::atoi(value.c_str());
+        else if (arg == "--max-steps")  options.maxSteps = std::atoi(value.c_str());
+        else if (arg == "--budget")     options.budgetMs = std::atof(value.c_str());
+        else if (arg == "--rate")       options.rate = static_cast<float>(std::atof(value.c_str()));
+        else if (arg == "--cloths")     options.cloths = std::atoi(value.c_str());
+        else if (arg == "--seed")       options.seed = std::atoll(value.c_str());
+        else if (arg == "--sleep") {
+            if (value == "on")          options.sleep = true;
+            else if (value == "off")    options.sleep = false;
+            else {
+                std::cerr << "Unknown sleep setting: " << value << '\n';
+                return false;
+            }
+        }
+        else if (arg == "--blocking") {
+            if (value == "on")          options.blocking = true;
+            else if (value == "off")    options.blocking = false;
+            else {
+                std::cerr << "Unknown blocking setting: " << value << '\n';
+                return false;
+            }
+        }
+        else if (arg == "--validate") {
+            if (value == "on")          options.validate = true;
+            else if (value == "off")    options.validate = false;
+            else {
+                std::cerr << "Unknown validate setting: " << value << '\n';
+                return false;
+            }
+        }
+        else if (arg == "--layout") {
+            if (value == "rows")        options.layout = ParticleLayout::ROWS;
+            else if (value == "tiles")  options.layout = ParticleLayout::TILES;
+            else {
+                std::cerr << "Unknown layout: " << value << '\n';
+                return false;
+            }
+        }
+        else if (arg == "--overrun") {
+            if (value == "drop")        options.overrun = OverrunPolicy::DROP;
+            else if (value == "slow")   options.overrun = OverrunPolicy::SLOW;
+            else {
+                std::cerr << "Unknown overrun policy: " << value << '\n';
+                return false;
+            }
+        }
+        else if (arg == "--mode") {
+            if (value == "tear")            options.mode = SimulationMode::TEAR;
+            else if (value == "collision")  options.mode = SimulationMode::COLLISION;
+            else if (value == "flag")       options.mode = SimulationMode::FLAG;
+            else {
+                std::cerr << "Unknown mode: " << value << '\n';
+                return false;
+            }
+        } else if (arg == "--solver") {
+            if (value == "pbd")         options.solver = SolverMode::PBD;
+            else if (value == "xpbd")   options.solver = SolverMode::XPBD;
+            else {
+                std::cerr << "Unknown solver: " << value << '\n';
+                return false;
+            }
+        } else {
+            std::cerr << "Unknown option: " << arg << '\n';
+            return false;
+        }
+    }
+
+    if (options.width < 2 || options.height < 2 || options.frames < 1 || options.deltaTime <= 0.0f ||
+        options.cloths < 1) {
+        std::cerr << "Grid must be at least 2x2 and frames/dt/cloths positive\n";
+        return false;
+    }
+    return true;
+}
+
+// a tear brush stroke 1.5 units long through a random vertex, in a random direction in the xy plane
+void cutAtRandom(ClothSystem& cloth, std::mt19937& random) {
+    std::vector<float> positions(cloth.getVertexCount() * 3), normals(positions.size());
+    if (positions.empty()) return;
+    cloth.writeVertices(positions.data(), normals.data());
+    
+    size_t vertex = std::uniform_int_distribution<size_t>(0, cloth.getVertexCount() - 1)(random);
+    glm::vec3 center(positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2]);
+    float angle = std::uniform_real_distribution<float>(0.0f, 6.2831853f)(random);
+    glm::vec3 direction(std::cos(angle), std::sin(angle), 0.0f);
+    
+    for (float t = -0.75f; t <= 0.75f; t += 0.02f) {
+        cloth.handleMouseInteraction(center + direction * t, true);
+    }
+}
+
+void printPhase(const char* name, double seconds, const Options& options, size_t particles) {
+    double perFrameMs = seconds * 1000.0 / options.frames;
+    double perParticleNs = seconds * 1e9 / (double(options.frames) * particles);
+
+    std::cout << std::left << std::setw(14) << name << std::right
+              << std::setw(12) << std::fixed << std::setprecision(2) << seconds * 1000.0
+              << std::setw(14) << std::setprecision(4) << perFrameMs
+              << std::setw(16) << std::setprecision(2) << perParticleNs << '\n';
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // cloths side by side along x, 5 units apart
+    ClothWorld world;
+    for (int i = 0; i < options.cloths; ++i) {
+        float offset = (i - (options.cloths - 1) * 0.5f) * 5.0f;
+        ClothSystem& cloth = world.addCloth(options.width, options.height, 4.0f, 4.0f, glm::vec3(offset, 0.0f, 0.0f));
+        
+        // rebuilds the cloth, so before anything else is set
+        cloth.setParticleLayout(options.layout);
+        cloth.setMode(options.mode);
+        cloth.setSolverMode(options.solver);
+        cloth.applyDefaultSplit();
+        if (options.substeps > 0)   cloth.setSubsteps(options.substeps);
+        if (options.iterations > 0) cloth.setSolverIterations(options.iterations);
+        if (options.rate > 0.0f)    cloth.setFixedTimeStep(1.0f / options.rate);
+        if (options.maxSteps > 0)   cloth.setMaxStepsPerFrame(options.maxSteps);
+        if (options.budgetMs > 0.0) cloth.setStepBudget(options.budgetMs / 1000.0);
+        cloth.setOverrunPolicy(options.overrun);
+        if (options.seed >= 0)      cloth.setSeed(static_cast<uint32_t>(options.seed + i));
+        cloth.setSleeping(options.sleep);
+        cloth.setCacheBlocking(options.blocking);
+        cloth.setIslandChecks(options.validate);
+    }
+    const ClothSystem& first = world.getCloth(0);
+
+    std::cout << "Grid: " << options.width << "x" << options.height << " x " << options.cloths << " cloth(s)"
+              << " (" << world.getParticleCount() << " particles, "
+              << first.getSpringCount() * options.cloths << " springs)\n";
+    std::cout << "Solver: " << (options.solver == SolverMode::XPBD ? "XPBD" : "PBD")
+              << ", " << first.getSubsteps() << " substeps x " << first.getSolverIterations() << " iterations\n";
+    std::cout << "SIMD: " << ParticleKernels::levelName(ParticleKernels::get().level)
+              << ", threads: " << ThreadPool::shared().size() << '\n';
+
+    for (size_t i = 0; i < world.getClothCount(); ++i) {
+        world.getCloth(i).resetPhaseTimings();
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    std::mt19937 random(static_cast<uint32_t>(options.seed >= 0 ? options.seed : 1));
+    for (int frame = 0; frame < options.frames; ++frame) {
+        // cuts go in between frames, like the mouse, and are timed along with the frame
+        if (options.validate && frame % 10 == 5) {
+            for (size_t i = 0; i < world.getClothCount(); ++i) {
+                cutAtRandom(world.getCloth(i), random);
+            }
+        }
+        world.update(options.deltaTime);
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    // summed over cloths - with several cloths stepping concurrently this is thread time, not wall time
+    PhaseTimings timings;
+    for (size_t i = 0; i < world.getClothCount(); ++i) {
+        timings += world.getCloth(i).getPhaseTimings();
+    }
+    size_t particles = world.getParticleCount();
+    
+    int sleepingTiles = 0, tiles = 0, islands = 0, sleepingIslands = 0;
+    for (size_t i = 0; i < world.getClothCount(); ++i) {
+        sleepingTiles += world.getCloth(i).getSleepingTileCount();
+        tiles += world.getCloth(i).getTileCount();
+        islands += world.getCloth(i).getIslandCount();
+        sleepingIslands += world.getCloth(i).getSleepingIslandCount();
+    }
+
+    std::cout << '\n' << options.frames << " frames, " << timings.steps << " fixed steps, "
+              << timings.skippedSteps << " skipped, " << sleepingTiles << "/" << tiles << " tiles asleep at the end, "
+              << islands << " island(s), " << sleepingIslands << " asleep\n\n";
+    std::cout << std::left << std::setw(14) << "phase" << std::right
+              << std::setw(12) << "total ms" << std::setw(14) << "ms/frame" << std::setw(16) << "ns/particle" << '\n';
+
+    printPhase("forces", timings.forces, options, particles);
+    printPhase("integrate", timings.integrate, options, particles);
+    printPhase("constraints", timings.constraints, options, particles);
+    printPhase("collisions", timings.collisions, options, particles);
+    printPhase("normals", timings.normals, options, particles);
+    printPhase("bookkeeping", timings.bookkeeping, options, particles);
+    printPhase("vertex data", timings.vertexData, options, particles);
+    printPhase("total", timings.total(), options, particles);
+
+    std::cout << "\nWall time: " << std::fixed << std::setprecision(2) << wall * 1000.0 << " ms ("
+              << std::setprecision(1) << options.frames / wall << " frames/s)\n";
+    
+    if (options.validate) {
+        int mismatches = 0;
+        for (size_t i = 0; i < world.getClothCount(); ++i) {
+            mismatches += world.getCloth(i).getIslandMismatches();
+        }
+        std::cout << "Island checks: " << timings.steps << " steps, " << mismatches << " mismatch(es)\n";
+        if (mismatches > 0) return 1;
+    }
+
+    return 0;
+}